@@ -3,8 +3,11 @@ from .mcts import MCTSAgent
 
 
 def PyConvNetAgent(network, c_puct, **constraint):
+    """
+    Pass "c_batch" in constraint to let MCTS evaluate leaves in batches through network.eval_states.
+    """
     return MCTSAgent(
-        policy=Policy(eval_state=network.eval_state, c_puct=c_puct),
+        policy=Policy(eval_state=network.eval_state, batch_eval_state=network.eval_states, c_puct=c_puct),
         **constraint
     )
 
@@ -6,6 +6,12 @@ class MCTSAgent(Agent):
     """
     Agent Based on Monte Carlo Tree Search.
     Use "c_iterations" or "c_duration" as constraint.
+    Use "c_threads" for parallel search, and "c_parallelism" (MCTS.Parallelism.Tree/Root) to choose
+    between one shared tree and an ensemble of independent trees.
+    Use "c_batch" to evaluate leaves in batches if the policy provides "batch_eval_state".
+    Use "c_table_size" (in bytes) to share evaluations of transposed positions through a transposition table.
+    With "c_duration", set "mcts.game_budget" to split a whole-game time budget across moves.
+    Use "c_node_budget" to cap the tree size; the coldest subtrees are pruned once it is reached.
     """
     def __init__(self, policy=None, **constraint):
         self.mcts = MCTS(policy=policy, **constraint)
@@ -27,9 +33,9 @@ class MCTSAgent(Agent):
         return "MCTS Agent with {}".format(self.mcts.policy.__class__.__name__)
 
 
-def RandomMCTSAgent(c_puct, c_rollouts=5, **constraint):
+def RandomMCTSAgent(c_puct, c_rollouts=5, c_nearby=False, **constraint):
     return MCTSAgent(
-        policy=RandomPolicy(c_puct, c_rollouts),
+        policy=RandomPolicy(c_puct, c_rollouts, c_nearby),
         **constraint
     )
 
@@ -1,6 +1,6 @@
 from .bin import module_path as __origin__  # Add proper CorePyExt's path to sys path
-from CorePyExt import GameConfig, Player, Position, Board
-from CorePyExt import Node, Policy, MCTS
+from CorePyExt import GameConfig, Player, Position, Board, CompactBoard, seed_random
+from CorePyExt import Node, Policy, MCTS, node_pool_stats
 from CorePyExt import RandomPolicy, PoolRAVEPolicy, TraditionalPolicy
 
 del bin  # Clear the intermediary module
@@ -2,9 +2,13 @@
 #define GOMOKU_AGENT_H_
 #include <iostream>
 #include <string>
+#include <thread>
+#include <atomic>
+#include <cmath>
 #include <nlohmann/json.hpp>
 #include "Game.h"
 #include "MCTS.h"
+#include "OpeningBook.h"
 #include "Pattern.h"
 #include "algorithms/Heuristic.hpp"
 
@@ -27,6 +31,18 @@ public:
     virtual void syncWithBoard(Board& board) { };
 
     virtual void reset() { }
+
+    // 在对手思考期间利用空闲时间搜索，board为己方落子后的局面。
+    virtual void startPondering(const Board& board) { }
+
+    // 停止后台搜索。须在下一次syncWithBoard之前调用。
+    virtual void stopPondering() { }
+
+    // 将可跨进程复用的搜索状态写入文件，board为己方落子后的局面。
+    virtual void saveState(const std::string& path, Board& board) { }
+
+    // 读回saveState写入的搜索状态，在syncWithBoard之后调用。文件不可用时忽略。
+    virtual void loadState(const std::string& path, Board& board) { }
 };
 
 class HumanAgent : public Agent {
@@ -61,7 +77,12 @@ public:
 
 class MCTSAgent : public Agent {
 public:
-    MCTSAgent(milliseconds durations, Policy* policy) : c_duration(durations), m_policy(policy) { }
+    MCTSAgent(milliseconds durations, Policy* policy, size_t threads = 1, MCTS::Parallelism parallelism = MCTS::Parallelism::Tree, size_t node_budget = 0) 
+        : c_duration(durations), m_policy(policy), c_threads(threads), c_parallelism(parallelism), c_nodeBudget(node_budget) { }
+
+    virtual ~MCTSAgent() {
+        stopPondering();
+    }
 
     virtual std::string name() {
         using namespace std::chrono;
@@ -69,8 +90,15 @@ public:
     }
 
     virtual Position getAction(Board& board) {
+        if (m_book != nullptr) {
+            auto moves = m_book->probe(board);
+            m_bookMove = !moves.empty() && moves[0].weight >= c_bookWeight && board.moveState(Player::None, moves[0].move);
+            if (m_bookMove) {
+                return moves[0].move;
+            }
+        }
         auto [state_value, action_probs] = m_mcts->evalState(board);
-        Eigen::Map<const Eigen::Array<float, 15, 15, Eigen::RowMajor>> probs_2d(action_probs.data());
+        Eigen::Map<const Eigen::Array<float, HEIGHT, WIDTH, Eigen::RowMajor>> probs_2d(action_probs.data());
         std::cout << state_value << std::endl;
         //std::cout << probs_2d << std::endl;
         Position next_move;
@@ -79,16 +107,40 @@ public:
     }
 
     virtual json debugMessage() {
+        using std::chrono::duration;
+        auto memory = NodePool::Stats();
+        auto& stats = m_mcts->m_stats;
+        auto phase_ms = [&](SearchStats::Phase phase) { return duration<double, std::milli>(stats.phaseTime(phase)).count(); };
         return {
             { "iterations", m_mcts->m_iterations },
-            { "duration",   std::to_string(m_mcts->m_duration.count()) + "ms" }
+            { "nodes",      m_mcts->m_size },
+            { "memory",     std::to_string(memory.reserved_bytes >> 20) + "MB" },
+            { "duration",   std::to_string(m_mcts->m_duration.count()) + "ms" },
+            { "elapsed",    std::to_string(m_mcts->m_timer.m_elapsed.count()) + "ms" },
+            { "threads",    m_mcts->c_threads },
+            { "pondered",   m_pondered },
+            { "loaded",     m_loaded },
+            { "book",       m_bookMove },
+            { "solved",     m_mcts->solved() },
+            { "stats", {
+                { "playouts",      stats.playouts },
+                { "playouts/s",    std::lround(stats.playoutsPerSecond()) },
+                { "created",       stats.nodes_created },
+                { "depth",         { stats.averageDepth(), stats.max_depth } },
+                { "reuse",         stats.reuseRatio() },
+                { "evaluations",   stats.evaluations },
+                { "select_ms",     phase_ms(SearchStats::Select) },
+                { "expand_ms",     phase_ms(SearchStats::Expand) },
+                { "simulate_ms",   phase_ms(SearchStats::Simulate) },
+                { "backprop_ms",   phase_ms(SearchStats::BackPropogate) }
+            } }
         };
     };
 
     virtual void syncWithBoard(Board& board) {
         if (m_mcts == nullptr) {
             auto last_action = board.m_moveRecord.empty() ? Position(-1) : board.m_moveRecord.back();
-            m_mcts = std::make_unique<MCTS>(c_duration, last_action, -board.m_curPlayer, m_policy);
+            m_mcts = std::make_unique<MCTS>(c_duration, last_action, -board.m_curPlayer, m_policy, c_threads, c_parallelism, 1, 0, c_nodeBudget);
         } else {
             m_mcts->syncWithBoard(board);
         }
@@ -98,10 +150,63 @@ public:
         m_mcts->reset();
     }
 
+    // 后台思考沿用本Agent的线程数与并行方式；未设置结点数预算时，结点数达到MCTS::c_ponderBudget后提前结束。
+    virtual void startPondering(const Board& board) {
+        if (m_mcts == nullptr || m_ponder.joinable()) {
+            return;
+        }
+        m_ponderBoard = board;
+        m_ponderStop = false;
+        m_ponder = std::thread([this]() { m_pondered = m_mcts->ponder(m_ponderBoard, m_ponderStop); });
+    }
+
+    virtual void stopPondering() {
+        if (m_ponder.joinable()) {
+            m_ponderStop = true;
+            m_ponder.join();
+        }
+    }
+
+    // 设置开局库。局面已收录且其最佳着法的权重不少于min_weight时，直接走该着法而不再搜索。
+    void setOpeningBook(std::shared_ptr<const OpeningBook> book, size_t min_weight = 1) {
+        m_book = std::move(book);
+        c_bookWeight = min_weight;
+    }
+
+    virtual void saveState(const std::string& path, Board& board) {
+        if (m_mcts != nullptr) {
+            m_mcts->syncWithBoard(board); // 只保存己方落子后仍会被复用的子树
+            m_mcts->save(path, board);
+        }
+    }
+
+    virtual void loadState(const std::string& path, Board& board) {
+        if (m_mcts != nullptr) {
+            m_loaded = m_mcts->load(path, board) ? size_t(m_mcts->m_root->node_visits) : 0;
+        }
+    }
+
 protected:
     std::unique_ptr<MCTS> m_mcts;
     std::shared_ptr<Policy> m_policy;
     std::chrono::milliseconds c_duration;
+    size_t c_threads;
+    MCTS::Parallelism c_parallelism;
+    size_t c_nodeBudget;
+
+    // 后台思考的线程与其所用的棋盘拷贝，m_pondered为上一次后台思考的迭代次数
+    std::thread m_ponder;
+    std::atomic<bool> m_ponderStop = false;
+    Board m_ponderBoard;
+    size_t m_pondered = 0;
+
+    // 上一次从文件读回的树在换根后的根结点访问次数，为0表示未能复用
+    size_t m_loaded = 0;
+
+    // 开局库，m_bookMove表示上一手是否取自开局库
+    std::shared_ptr<const OpeningBook> m_book;
+    size_t c_bookWeight = 1;
+    bool m_bookMove = false;
 };
 
 class PatternEvalAgent : public Agent {
@@ -6,7 +6,9 @@
 
 namespace Gomoku::Interface {
 
-inline int BotzoneInterface(Agent& agent) {
+// state_path非空时，每回合结束前将搜索树写入该文件，下一回合的进程再将其读回，以便在回合间复用已搜索的子树。
+// Botzone上须使用data目录下的路径，如"./data/tree.bin"。
+inline int BotzoneInterface(Agent& agent, const std::string& state_path = "") {
     using namespace std;
 
     Board board;
@@ -22,15 +24,23 @@ inline int BotzoneInterface(Agent& agent) {
     board.applyMove(input["requests"][turnID], false); // play newest move
 
     agent.syncWithBoard(board);
+    if (!state_path.empty()) {
+        agent.loadState(state_path, board);
+    }
     output["response"] = agent.getAction(board); // response to newest move
     output["debug"] = agent.debugMessage();
 
     cout << output << endl;
+    if (!state_path.empty()) { // 先输出结果，再保存搜索树
+        board.applyMove(output["response"], false);
+        agent.saveState(state_path, board);
+    }
 
     return 0;
 }
 
-inline int KeepAliveBotzoneInterface(Agent& agent) {
+// ponder为true时，在等待对手落子期间由Agent在后台继续搜索，收到输入后停止并复用已搜索的子树。
+inline int KeepAliveBotzoneInterface(Agent& agent, bool ponder = false) {
     using namespace std;
 
     Board board;
@@ -39,6 +49,7 @@ inline int KeepAliveBotzoneInterface(Agent& agent) {
         json input, output;
 
         cin >> input;
+        agent.stopPondering();
         if (turn == 0) { // restore board state in first turn
             int turnID = input.count("responses") ? input["responses"].size() : 0;
             for (int i = 0; i < turnID; i++) {
@@ -57,6 +68,9 @@ inline int KeepAliveBotzoneInterface(Agent& agent) {
 
         cout << output << "\n";
         cout << ">>>BOTZONE_REQUEST_KEEP_RUNNING<<<" << endl; // stdio flushed by endl
+        if (ponder) {
+            agent.startPondering(board);
+        }
     }
 
     return 0;
@@ -14,7 +14,9 @@ int main() {
     PatternEvalAgent agent7;
     //MCTSAgent agent7x(50000, new PoolRAVEPolicy(2, 0));
 
+    //agent6.setOpeningBook(std::make_shared<Gomoku::OpeningBook>("./data/book.bin"));
+
     return ConsoleInterface(agent6, agent6x);
-    //return KeepAliveBotzoneInterface(agent6);
-    //return BotzoneInterface(agent6);
+    //return KeepAliveBotzoneInterface(agent6, true);
+    //return BotzoneInterface(agent6, "./data/tree.bin");
 }
\ No newline at end of file
@@ -3,16 +3,37 @@
 #include <utility> // std::pair, std::size_t
 #include <vector>  // std::vector
 #include <array>   // std::array
+#include <bitset>  // std::bitset
+#include <cstdint> // std::uint64_t
 #include <Eigen/Dense> // Eigen::VectorXf
+#if defined(_MSC_VER)
+#include <intrin.h> // __popcnt64, _BitScanForward64
+#endif
 
 namespace Gomoku {
 
+/*
+    棋盘尺寸在编译期确定，默认为15*15。可通过宏（如-DGOMOKU_BOARD_WIDTH=20）为其他尺寸单独构建，
+    此时Board、BoardMap、Evaluator与MCTS中的所有尺寸相关量都仍是编译期常量，无需运行期分支。
+*/
+#ifndef GOMOKU_BOARD_WIDTH
+#define GOMOKU_BOARD_WIDTH 15
+#endif
+#ifndef GOMOKU_BOARD_HEIGHT
+#define GOMOKU_BOARD_HEIGHT GOMOKU_BOARD_WIDTH
+#endif
+
 inline namespace Config {
 // 游戏的基本配置
 enum GameConfig {
-    WIDTH = 15, HEIGHT = 15, MAX_RENJU = 5, 
-    BOARD_SIZE = WIDTH*HEIGHT
+    WIDTH = GOMOKU_BOARD_WIDTH, HEIGHT = GOMOKU_BOARD_HEIGHT, MAX_RENJU = 5, 
+    BOARD_SIZE = WIDTH*HEIGHT,
+    CANDIDATE_RANGE = 2, // 邻域候选点与已有棋子的最大切比雪夫距离
+    LINE_COUNT = 3*(WIDTH + HEIGHT) - 2 // 横、竖与两组斜向直线的总条数
 };
+
+static_assert(WIDTH >= MAX_RENJU && HEIGHT >= MAX_RENJU, "Board is too small to get a renju.");
+static_assert(BOARD_SIZE <= 32767, "Position stores its id in a short.");
 }
 
 // 玩家概念的抽象封装
@@ -56,6 +77,95 @@ struct Position {
 };
 
 
+// 以64位字为单元压缩存储的棋盘位图，第id位对应Position(id)处的格子。
+// 超出BOARD_SIZE的高位始终保持为0，因此计数与遍历均无需额外掩码。
+struct BitBoard {
+    static constexpr int Words = (BOARD_SIZE + 63) / 64;
+
+    std::uint64_t words[Words] = {};
+
+    // 统计64位字中置1的位数。
+    static int PopCount(std::uint64_t word) {
+#if defined(_MSC_VER) && defined(_M_X64)
+        return static_cast<int>(__popcnt64(word));
+#elif defined(__GNUC__)
+        return __builtin_popcountll(word);
+#else
+        return static_cast<int>(std::bitset<64>(word).count());
+#endif
+    }
+
+    // 返回64位字中最低的置1位的下标。要求word不为0。
+    static int LowestBit(std::uint64_t word) {
+#if defined(_MSC_VER) && defined(_M_X64)
+        unsigned long index;
+        return _BitScanForward64(&index, word), static_cast<int>(index);
+#elif defined(__GNUC__)
+        return __builtin_ctzll(word);
+#else
+        return PopCount((word & -word) - 1);
+#endif
+    }
+
+    bool test(Position pose) const { return (words[pose.id >> 6] >> (pose.id & 63)) & 1; }
+    void set(Position pose)        { words[pose.id >> 6] |= (1ull << (pose.id & 63)); }
+    void reset(Position pose)      { words[pose.id >> 6] &= ~(1ull << (pose.id & 63)); }
+    bool operator[](Position pose) const { return test(pose); }
+
+    // 将前BOARD_SIZE位全部置为value。
+    void fill(bool value) {
+        for (int i = 0; i < Words; ++i) {
+            words[i] = value ? ~0ull : 0ull;
+        }
+        if (value && BOARD_SIZE % 64 != 0) {
+            words[Words - 1] = (1ull << (BOARD_SIZE % 64)) - 1;
+        }
+    }
+
+    // 利用popcount统计置1的格子数。
+    std::size_t count() const {
+        std::size_t sum = 0;
+        for (auto word : words) {
+            sum += PopCount(word);
+        }
+        return sum;
+    }
+
+    // 按id从小到大遍历所有置1的格子。
+    template <typename Func>
+    void forEach(Func func) const {
+        for (int i = 0; i < Words; ++i) {
+            for (auto word = words[i]; word != 0; word &= word - 1) {
+                func(Position(i * 64 + LowestBit(word)));
+            }
+        }
+    }
+
+    // 返回第n个（从0计）置1的格子，要求n < count()。先按字跳过，再在目标字内逐位清除。
+    Position nth(std::size_t n) const {
+        for (int i = 0; ; ++i) {
+            const auto popcount = static_cast<std::size_t>(PopCount(words[i]));
+            if (n < popcount) {
+                auto word = words[i];
+                for (; n != 0; --n) { 
+                    word &= word - 1; 
+                }
+                return Position(i * 64 + LowestBit(word));
+            }
+            n -= popcount;
+        }
+    }
+
+    // 按id展开为0/1数组，dst至少需有BOARD_SIZE个元素。
+    template <typename T>
+    void unpack(T* dst) const {
+        for (int i = 0; i < BOARD_SIZE; ++i) {
+            dst[i] = static_cast<T>(test(i));
+        }
+    }
+};
+
+
 class Board {
 // 公开接口部分
 public:
@@ -76,9 +186,12 @@ public:
     */
     Player revertMove(size_t count = 1);
 
-    // 获取均匀概率分布的随机的可行落点。
+    // 获取均匀概率分布的随机的可行落点。只需一次随机数抽取与一次下标访问。
     Position getRandomMove() const;
 
+    // 获取邻域候选点集上均匀分布的随机落点。候选集为空（如空棋盘）时退化为getRandomMove()。
+    Position getRandomCandidate() const;
+
     // 根据提供的概率分布随机获取可行落点。若非法点概率不为0，则不保证返回的点一定合法。
     Position getRandomMove(Eigen::Ref<Eigen::VectorXf> probs) const;
 
@@ -93,6 +206,26 @@ public:
 
     // 重置棋盘到初始状态。
     void reset();
+
+    /*
+        棋盘快照。与revertMove逐步悔棋不同，restore通过一次拷贝直接回到快照时的局面：
+        - 快照只记录棋谱长度，因此只能恢复到当前局面的「祖先」局面（即快照后棋谱的前缀未被悔掉过）。
+        - 典型用法为Rollout前取快照，Rollout后恢复。
+    */
+    struct Snapshot {
+        BitBoard moveStates[3];
+        std::uint32_t lineStates[2][LINE_COUNT];
+        BitBoard candidates;
+        std::uint8_t neighborCounts[BOARD_SIZE];
+        Player curPlayer;
+        Player winner;
+        std::uint64_t hash;
+        std::size_t records;
+    };
+
+    Snapshot snapshot() const;
+
+    void restore(const Snapshot& snapshot);
     
 // 数据成员封装部分
 public: 
@@ -105,15 +238,29 @@ public:
     }
 
     // 通过Player枚举获取对应棋盘状态
-    std::array<bool, BOARD_SIZE>&       moveStates(Player player) { return m_moveStates[static_cast<int>(player) + 1]; }
-    const std::array<bool, BOARD_SIZE>& moveStates(Player player) const { return m_moveStates[static_cast<int>(player) + 1]; }
+    BitBoard&       moveStates(Player player) { return m_moveStates[static_cast<int>(player) + 1]; }
+    const BitBoard& moveStates(Player player) const { return m_moveStates[static_cast<int>(player) + 1]; }
     
     // 获取棋盘在对应Position上的Player状态。仅提供只读接口。
-    bool moveState(Player player, Position pose) const { return m_moveStates[static_cast<int>(player) + 1][pose.id]; }
+    bool moveState(Player player, Position pose) const { return m_moveStates[static_cast<int>(player) + 1].test(pose); }
+
+    // 通过Player枚举获取对应玩家按直线打包的位图。仅对Player::Black与Player::White有效。
+    std::uint32_t*       lineStates(Player player) { return m_lineStates[player == Player::Black]; }
+    const std::uint32_t* lineStates(Player player) const { return m_lineStates[player == Player::Black]; }
 
-    // 通过Player枚举获取已落子/未落子总数
-    std::size_t& moveCounts(Player player) { return m_moveCounts[static_cast<int>(player) + 1]; }
-    std::size_t  moveCounts(Player player) const { return m_moveCounts[static_cast<int>(player) + 1]; }
+    // 获取player在pose处落子所对应的Zobrist键值。player为Player::None时返回轮换应下方的键值。
+    static std::uint64_t ZobristKey(Player player, Position pose = 0);
+
+    // 在当前局面下由应下方走move后所得局面的Zobrist键值，无需实际落子。不检查move的有效性。
+    std::uint64_t hashAfter(Position move) const { 
+        return m_hash ^ ZobristKey(m_curPlayer, move) ^ ZobristKey(Player::None); 
+    }
+
+    // 邻域候选点集：与任意棋子的切比雪夫距离不超过CANDIDATE_RANGE的空位。
+    const BitBoard& candidates() const { return m_candidates; }
+
+    // 通过Player枚举获取已落子/未落子总数，由位图的popcount得到。
+    std::size_t moveCounts(Player player) const { return moveStates(player).count(); }
 
     // 输出对阅读友好的字符串
     std::string toString() const;
@@ -137,21 +284,136 @@ public:
     Player m_winner = Player::None;
 
     /*
-        两个数组表示了棋盘上的状态与已落子个数。各下标对应关系为：
+        三个位图表示了棋盘上的状态，已落子个数由popcount求得。各下标对应关系为：
         0 - Player::White - 白子放置情况
         1 - Player::None  - 可落子位置情况
         2 - Player::Black - 黑子放置情况
-        附：为什么不使用std::vector呢？因为vector<bool> :)。
     */
-    std::array<bool, BOARD_SIZE> m_moveStates[3] = {};
-    std::size_t m_moveCounts[3] = {};
+    BitBoard m_moveStates[3] = {};
+
+    /*
+        按直线打包的黑/白棋位图，供连珠检测的移位-掩码运算使用。第一维为{ White, Black }。
+        第二维的直线排布与BoardMap::ParseIndex一致：行、列、左上-右下斜线、右上-左下斜线。
+        每条直线的两端各留出MAX_RENJU-1个空位，使得以任意格子为中心的检测窗口都不会越界。
+    */
+    std::uint32_t m_lineStates[2][LINE_COUNT] = {};
+
+    /*
+        未落子格子的稠密列表，其前(BOARD_SIZE - 棋谱长度)个元素恰为全部空位（顺序无关）：
+        - 下棋时，将落子位置与末位空位交换后移出边界。
+        - 悔棋严格按栈序进行，被悔掉的一手必然正好位于边界上，故边界随棋谱缩短自然恢复，无需任何操作。
+        m_emptyIndices记录各位置在列表中的下标，用于O(1)定位。
+    */
+    std::array<Position, BOARD_SIZE> m_emptyCells;
+    std::array<short, BOARD_SIZE> m_emptyIndices;
+
+    /*
+        邻域候选点集，供Expand与Rollout削减远离棋子的分支，随下棋/悔棋增量更新：
+        - m_neighborCounts记录每个格子邻域内的棋子数。下棋时邻域内计数加一，悔棋时减一，因此悔棋无需额外的栈。
+        - 计数由0变正且格子为空时加入候选集，计数归0时移出；落子处本身总在落子时移出、悔棋时按计数放回。
+    */
+    BitBoard m_candidates = {};
+    std::array<std::uint8_t, BOARD_SIZE> m_neighborCounts = {};
+
+    /*
+        当前局面的Zobrist键值，由盘面上的棋子与应下方（按已下手数的奇偶）共同决定，随下棋/悔棋增量更新：
+        - 空棋盘的键值为0，因此reset无需访问键值表。
+        - 游戏结束与否不影响键值，结束局面与其悔棋前的局面可互相还原。
+        - 键值表在编译期由固定种子生成，跨进程、跨机器保持一致，可用于持久化的缓存或开局库。
+    */
+    std::uint64_t m_hash = 0;
 
     //保存了棋局的完整记录的栈式结构。
     std::vector<Position> m_moveRecord;
 };
 
+// 紧凑的棋盘快照，用于棋谱缓冲区与日志的大量存储。
+// 黑/白两个平面各按每格1位打包（合计每格2位），另记录应下玩家与最后两手。15*15时恰为64字节。
+struct CompactBoard {
+    static constexpr int PlaneBytes = (BOARD_SIZE + 7) / 8;
+
+    /*
+        按位打包的棋子平面，第一维为 { Player::Black, Player::White }。
+        第id位（即第id/8字节的第id%8位）对应Position(id)处的格子，与numpy.unpackbits(bitorder='little')一致。
+    */
+    std::uint8_t planes[2][PlaneBytes] = {};
+
+    // 当前应下的玩家，游戏结束时为Player::None。
+    Player curPlayer = Player::Black;
+
+    // 最后一手与倒数第二手，不存在时为Position::npos。
+    Position lastMoves[2] = { Position::npos, Position::npos };
+
+    CompactBoard() = default;
+
+    // 从Board打包，只需遍历位图的各个字节。
+    explicit CompactBoard(const Board& board);
+
+    // 解包为Board。其余棋子按黑白交替的顺序重放，最后两手保持原顺序，因此胜负状态与原棋盘一致。
+    Board toBoard() const;
+
+    bool test(Player player, Position pose) const { 
+        return (planes[player == Player::White][pose.id >> 3] >> (pose.id & 7)) & 1; 
+    }
+};
+
 // 统一的随机数引擎
+// 基于xoshiro256**的轻量发生器，满足UniformRandomBitGenerator的要求，可直接配合<random>中的各类分布使用。
+// 默认每个线程持有一个独立的实例（见Local），互不干扰；需要复现结果时，可通过Seed为当前线程显式播种。
+class RandomEngine {
+public:
+    using result_type = std::uint64_t;
+
+    static constexpr result_type min() { return 0; }
+    static constexpr result_type max() { return ~result_type(0); }
+
+    // 当前线程的随机数引擎。首次使用时由random_device与线程标识共同播种。
+    static RandomEngine& Local();
 
+    // 为当前线程的随机数引擎显式播种。
+    static void Seed(std::uint64_t seed) { Local().seed(seed); }
+
+    explicit RandomEngine(std::uint64_t seed = 0) { this->seed(seed); }
+
+    // 利用SplitMix64将64位种子扩展为256位状态，保证状态不全为0。
+    void seed(std::uint64_t seed) {
+        for (auto& word : m_state) {
+            std::uint64_t z = (seed += 0x9e3779b97f4a7c15ull);
+            z = (z ^ (z >> 30)) * 0xbf58476d1ce4e5b9ull;
+            z = (z ^ (z >> 27)) * 0x94d049bb133111ebull;
+            word = z ^ (z >> 31);
+        }
+    }
+
+    result_type operator()() {
+        const auto result = rotl(m_state[1] * 5, 7) * 9;
+        const auto t = m_state[1] << 17;
+        m_state[2] ^= m_state[0];
+        m_state[3] ^= m_state[1];
+        m_state[1] ^= m_state[2];
+        m_state[0] ^= m_state[3];
+        m_state[2] ^= t;
+        m_state[3] = rotl(m_state[3], 45);
+        return result;
+    }
+
+    // 返回[0, bound)上严格均匀分布的整数。采用Lemire的乘法-拒绝法，绝大多数情况下只需一次乘法。
+    std::uint32_t bounded(std::uint32_t bound) {
+        auto product = static_cast<std::uint64_t>(static_cast<std::uint32_t>((*this)() >> 32)) * bound;
+        if (static_cast<std::uint32_t>(product) < bound) {
+            const auto threshold = static_cast<std::uint32_t>(-bound) % bound;
+            while (static_cast<std::uint32_t>(product) < threshold) {
+                product = static_cast<std::uint64_t>(static_cast<std::uint32_t>((*this)() >> 32)) * bound;
+            }
+        }
+        return static_cast<std::uint32_t>(product >> 32);
+    }
+
+private:
+    static std::uint64_t rotl(std::uint64_t x, int k) { return (x << k) | (x >> (64 - k)); }
+
+    std::uint64_t m_state[4];
+};
 
 }
 
@@ -169,6 +431,14 @@ struct hash<Gomoku::Position> {
     }
 };
 
+// WARNING: 64位编译环境下sizeof(size_t)才能为64位
+template <>
+struct hash<Gomoku::Board> {
+    std::size_t operator()(const Gomoku::Board& board) const {
+        return board.m_hash;
+    }
+};
+
 // Custom Structure Binding
 template <std::size_t N>
 constexpr int get(const Gomoku::Position& pose) { return N == 0 ? pose.x() : pose.y(); }
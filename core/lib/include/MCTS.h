@@ -5,6 +5,13 @@
 #include <memory>      // std::unique_ptr
 #include <chrono>      // std::milliseconds
 #include <functional>  // std::function
+#include <cstddef>     // std::size_t
+#include <atomic>      // std::atomic
+#include <thread>      // std::thread, std::this_thread::yield
+#include <list>        // std::list
+#include <optional>    // std::optional
+#include <string>      // std::string
+#include <algorithm>   // std::max
 #include <Eigen/Dense> // Eigen::VectorXf
 
 namespace Gomoku {
@@ -17,11 +24,71 @@ inline namespace Config {
     constexpr double C_PUCT = 5.0;
     constexpr size_t C_ITERATIONS = 10000;
     constexpr milliseconds C_DURATION = 1000ms;
+    constexpr size_t C_CHECK_INTERVAL = 64; // 时间管理器每隔多少次迭代读取一次根结点统计量
+    constexpr size_t C_SAMPLE_INTERVAL = 16; // 每隔多少次迭代测量一次各阶段的用时
+    constexpr float C_PROVEN_VALUE = 1e6f; // 已证明胜负的子结点在镜像中的价值绝对值，远大于PUCB项可能的取值
+    constexpr size_t C_PONDER_BUDGET = 1 << 15; // 未设结点数预算时后台思考的结点数上限。连同子结点槽与镜像每个结点约占5KB，合计约160MB
 }
 
+/*
+    蒙特卡洛树结点的内存池，为Node及其派生结点提供分配：
+    - 按Alignment对齐划分尺寸类别，以BlockSize为单位批量申请内存，释放的结点挂回对应类别的空闲链表以供复用。
+    - 每个线程持有一份本地空闲链表，分配与释放均无需加锁；仅在本地链表耗尽、申请新块或线程退出时访问全局部分。
+    - 申请的块在进程结束前不归还系统，reserved_bytes即为内存池占用的全部内存。
+    超过MaxSize的结点直接转交全局operator new，但仍计入统计。
+*/
+class NodePool {
+public:
+    static constexpr std::size_t Alignment = 8;
+    static constexpr std::size_t MaxSize = 256;
+    static constexpr std::size_t BlockSize = 64 * 1024;
+
+    struct Statistics {
+        std::size_t live_nodes;     // 当前存活的结点数（所有树合计）
+        std::size_t live_bytes;     // 当前存活结点按尺寸类别取整后的总字节数
+        std::size_t reserved_bytes; // 内存池已向系统申请的总字节数
+    };
+
+    static void* Allocate(std::size_t size);
+
+    static void Deallocate(void* ptr, std::size_t size) noexcept;
+
+    static Statistics Stats();
+};
+
+// 仅占1字节的自旋锁，用于树并行时保护结点的子结点集合与统计量。临界区都很短，因此不必挂起线程。
+struct SpinLock {
+    std::atomic<bool> locked = false;
+
+    void lock() noexcept {
+        while (locked.exchange(true, std::memory_order_acquire)) {
+            std::this_thread::yield();
+        }
+    }
+
+    void unlock() noexcept { 
+        locked.store(false, std::memory_order_release); 
+    }
+};
+
+// 以relaxed内存序读写的原子变量，用于树并行时可能被其他线程读取的结点统计量。
+// 写入总在对应结点锁的保护下进行，故复合赋值无需原子的读-改-写；在x86上其读写与普通变量无异。
+template <typename T>
+struct Relaxed {
+    std::atomic<T> value;
+
+    Relaxed(T value = T()) : value(value) { }
+
+    operator T() const noexcept { return value.load(std::memory_order_relaxed); }
+    Relaxed& operator=(T other) noexcept { return value.store(other, std::memory_order_relaxed), *this; }
+    Relaxed& operator+=(T other) noexcept { return *this = *this + other; }
+    Relaxed& operator-=(T other) noexcept { return *this = *this - other; }
+};
+
 // 蒙特卡洛树结点。
 // 由于整个树的结点数量十分庞大，因此其内存布局务必谨慎设计。
-// 32位下，sizeof(Node) == 32；64位下为56。
+// 32位下，sizeof(Node) == 44；64位下为72。
+// 虚析构函数使得经由基类指针释放派生结点时，NodePool能得到结点的实际尺寸。
 struct Node {
     /* 
         树结构部分 - 父结点。
@@ -37,42 +104,132 @@ struct Node {
     Position position = Position::npos;
     Player player = Player::None;
 
+    // 结点在父结点children中的下标，即其统计量在父结点child_stats镜像中的下标。
+    std::uint16_t index = 0;
+
+    /*
+        树并行时的结点锁，保护本结点的children、child_stats，以及各子结点的state_value与node_visits。
+        根结点没有父结点，其自身的统计量也由本锁保护。单线程搜索时不使用。
+    */
+    mutable SpinLock guard;
+
+    /*
+        证明状态（MCTS-Solver）：结点对应局面对于结点对应玩家已被证明为必胜、必败或和棋。
+        已证明结点的价值固定为1、-1或0，反向传播只累计其访问次数。占用锁之后的填充字节，不增大结点。
+    */
+    enum class Proof : std::int8_t { None, Win, Loss, Draw };
+    Proof proof = Proof::None;
+
     /* 
         结点价值部分：
           * state_value: 结点对应局面对于结点对应玩家的价值。一般为胜率。
           * action_prob: 在父结点对应的局面下，选择该动作的概率。
     */
-    float state_value = 0.0;
+    Relaxed<float> state_value = 0.0f;
     float action_prob = 0.0;
-    size_t node_visits = 0;
+    Relaxed<size_t> node_visits = 0;
 
     /*
         树结构部分 - 子结点。
         结点为独有指针集合，对每个子结点拥有所有权。
+        惰性扩展时，尚未被选中过的着法只占一个空指针，其位置与先验概率仅记录在child_stats中（价值与访问次数均为0）。
     */
     std::vector<std::unique_ptr<Node>> children = {};
 
+    /*
+        子结点统计量的SoA镜像：先验概率、价值、访问次数与位置依次各占一段长为children.size()的连续float数组。
+        Select只需在连续数组上做向量化运算，无需逐个解引用子结点。
+        已创建的子结点自身的属性仍是权威数据，修改后须调用其syncStats写回此处。
+        位置以float存储，可精确表示任意棋盘下标。
+    */
+    std::unique_ptr<float[]> child_stats = nullptr;
+
     /* 
         构造与赋值函数。
-        显式声明两个函数的移动版本，以阻止复制版本的自动生成。 
+        结点总在堆上创建并由unique_ptr持有，锁与原子统计量使其既不可复制也不可移动。 
     */
-    Node() = default;
-    Node(Node&&) = default;
-    Node& operator=(Node&&) = default;
+    Node(Node* parent = nullptr, Position pose = Position::npos, Player player = Player::None, float Q = .0f, float P = .0f)
+        : parent(parent), position(pose), player(player), state_value(Q), action_prob(P) { }
+    Node(const Node&) = delete;
+    Node& operator=(const Node&) = delete;
+    virtual ~Node() = default;
+
+    /* 结点统一由NodePool分配 */
+    static void* operator new(std::size_t size) { return NodePool::Allocate(size); }
+    static void operator delete(void* ptr, std::size_t size) noexcept { NodePool::Deallocate(ptr, size); }
 
     /* 辅助函数 */
     bool isLeaf() const { return children.empty(); }
     bool isFull(const Board& board) const { return children.size() == board.moveCounts(Player::None); }
+
+    const float* childPriors() const { return child_stats.get(); }
+    const float* childValues() const { return child_stats.get() + children.size(); }
+    const float* childVisits() const { return child_stats.get() + 2 * children.size(); }
+    Position childPosition(size_t i) const { return static_cast<int>(child_stats[3 * children.size() + i]); }
+
+    // 写入镜像的价值：已证明胜负的结点取±C_PROVEN_VALUE，使Select总是选中必胜的子结点、避开必败的子结点。
+    float mirrorValue() const {
+        return proof == Proof::Win ? C_PROVEN_VALUE : proof == Proof::Loss ? -C_PROVEN_VALUE : static_cast<float>(state_value);
+    }
+
+    // 标记结点为已证明，固定其价值并写回父结点的镜像
+    void prove(Proof result) {
+        proof = result;
+        state_value = result == Proof::Win ? 1.0f : result == Proof::Loss ? -1.0f : 0.0f;
+        syncStats();
+    }
+
+    // 按当前的children重建镜像并为子结点编号。在扩展或批量修改子结点后调用，要求所有子结点均已创建。
+    void buildStats() {
+        const auto n = children.size();
+        child_stats.reset(new float[4 * n]);
+        for (size_t i = 0; i < n; ++i) {
+            children[i]->index = static_cast<std::uint16_t>(i);
+            child_stats[i]         = children[i]->action_prob;
+            child_stats[n + i]     = children[i]->mirrorValue();
+            child_stats[2 * n + i] = static_cast<float>(children[i]->node_visits);
+            child_stats[3 * n + i] = static_cast<float>(children[i]->position.id);
+        }
+    }
+
+    // 将本结点的属性写回父结点的镜像。根结点或父结点未建立镜像时无需操作。
+    void syncStats() const {
+        if (parent != nullptr && parent->child_stats) {
+            const auto n = parent->children.size();
+            parent->child_stats[index]         = action_prob;
+            parent->child_stats[n + index]     = mirrorValue();
+            parent->child_stats[2 * n + index] = static_cast<float>(node_visits);
+        }
+    }
+
+    // 交换两个子结点的位置，同时交换其下标与镜像中的统计量。
+    void swapChildren(size_t i, size_t j) {
+        children[i].swap(children[j]);
+        if (children[i]) children[i]->index = static_cast<std::uint16_t>(i);
+        if (children[j]) children[j]->index = static_cast<std::uint16_t>(j);
+        if (child_stats) {
+            const auto n = children.size();
+            for (auto offset : { size_t(0), n, 2 * n, 3 * n }) {
+                std::swap(child_stats[offset + i], child_stats[offset + j]);
+            }
+        }
+    }
 };
 
 
+class MCTS;
+
+/*
+    蒙特卡洛树的策略。以下各个策略函数在构造时确定，此后不可替换：
+    单线程、树并行、批量评估与置换表等各条搜索路径因此总是调用同一实现（静态拼装的策略在单线程搜索时直接调用其成员函数）。
+*/
 class Policy {
 public:
     /*
         Tree-Policy中的选择阶段策略函数。
     */
     using SelectFunc = std::function<Node*(const Node*)>;
-    SelectFunc select;
+    const SelectFunc select;
 
     /*
         Tree-Policy中的扩展策略函数：
@@ -81,7 +238,7 @@ public:
         ③ 返回值为新增的结点数。
     */
     using ExpandFunc = std::function<size_t(Node*, Board&, const Eigen::VectorXf)>;
-    ExpandFunc expand;
+    const ExpandFunc expand;
 
     /*
         当Tree-Policy抵达中止点时，用于将棋下完（可选）并评估场面价值的Default-Policy：
@@ -90,7 +247,7 @@ public:
     */
     using EvalResult = std::tuple<float, const Eigen::VectorXf>;
     using EvalFunc = std::function<EvalResult(Board&)>;
-    EvalFunc simulate;
+    const EvalFunc simulate;
 
     /*
         Tree-Policy中的反向传播策略函数：
@@ -98,11 +255,32 @@ public:
         ② 结点的各种属性均在此函数中被更新。
     */
     using UpdateFunc = std::function<void(Node*, Board&, double)>;
-    UpdateFunc backPropogate;
+    const UpdateFunc backPropogate;
+
+    /*
+        批量评估函数（可选），用于神经网络等批量推断更高效的Default-Policy：
+        ① 一次评估多个互不相同的棋盘，返回值与传入的棋盘一一对应，含义同EvalFunc。
+        ② 设置后，MCTS在c_batch大于1时会先收集多个待评估的叶结点（以虚拟损失使其分散），再一次性交由该函数评估。
+        ③ 此时反向传播采用Default::ConcurrentBackPropogate的逻辑，且applyMove等须直接作用于传入的棋盘。
+        为nullptr时不进行批量评估。
+    */
+    using BatchEvalFunc = std::function<std::vector<EvalResult>(const std::vector<Board*>&)>;
+    const BatchEvalFunc batchSimulate;
+
+    /*
+        单线程搜索时一轮迭代的整体实现（可选），由Policies::StaticPolicy设置为MCTS::StaticPlayout<派生类>。
+        设置后，单线程搜索不再经由上述std::function，而是静态地调用派生类的各步骤。
+        为nullptr时使用MCTS::playout的通用流程。
+    */
+    using PlayoutKernel = size_t(*)(MCTS&, Board&);
+    PlayoutKernel playoutKernel = nullptr;
+
+    // 惰性扩展时，由Select在首次选中某一着法时创建的结点数。MCTS在每轮迭代后取走并计入m_size。
+    std::atomic<size_t> m_materialized = 0;
 
 public:
-    // 当其中某一项传入nullptr时，该项将使用一个默认策略初始化。
-    Policy(SelectFunc = nullptr, ExpandFunc = nullptr, EvalFunc = nullptr, UpdateFunc = nullptr, double = C_PUCT);
+    // 当前四项中的某一项传入nullptr时，该项将使用一个默认策略初始化。
+    Policy(SelectFunc = nullptr, ExpandFunc = nullptr, EvalFunc = nullptr, UpdateFunc = nullptr, double = C_PUCT, BatchEvalFunc = nullptr);
 
     // 用于多态生成树节点的Factory函数。
     virtual std::unique_ptr<Node> createNode(Node* parent, Position pose, Player player, float value, float prob);
@@ -126,59 +304,491 @@ public:
     // prepare在每回合都会调用，而reset在一整局游戏至多调用一次。
     virtual void reset() { }
 
+    /*
+        是否支持树并行，即多个线程共享同一棵树进行搜索。要求：
+        ① select、expand与simulate可被多个线程以各自的Board并发调用（select与expand调用时已持有结点锁）。
+        ② 反向传播可采用Default::ConcurrentBackPropogate的逻辑（backPropogate在树并行时不会被调用）。
+        默认不支持，此时多线程设置将退化为单线程搜索。
+    */
+    virtual bool isConcurrent() const { return false; }
+
+    // 以相同参数构造一个全新的策略对象，供根并行时每棵树独立使用。返回nullptr表示不支持复制。
+    virtual std::shared_ptr<Policy> clone() const { return nullptr; }
+
+    // 局面在置换表中的键值，调用时机与simulate相同。若策略类由内部棋盘代理下棋，应返回内部棋盘的哈希值。
+    virtual std::uint64_t hashKey(Board& board) { return board.m_hash; }
+
 public: // 共通属性
     double c_puct; // PUCT公式的Exploit-Explore平衡因子
+
+    // simulate对同一局面是否总给出相同的评估。为false时（如随机Rollout）置换表不缓存评估结果，以免各条路径共用同一个样本，但仍共享统计量。
+    // 未提供simulate时取默认的随机Rollout，因此为false；提供了simulate时默认为true。
+    bool c_deterministic;
     size_t m_initActs = 0; // MCTS的一轮Playout开始时，Board已下的棋子数。
 };
 
 
+/*
+    置换表：以局面的Zobrist哈希为键，在经由不同着法顺序到达的同一局面之间共享：
+    - 评估结果（场面价值与各处落子的概率）：扩展时直接复用，无需再次调用simulate。仅缓存确定性的评估（Policy::c_deterministic）。
+    - 统计量（访问次数与价值之和）：单线程搜索的每轮迭代将路径上各局面的价值累计到表中，结点的价值取累计后的平均（UCT2式）。
+      结点仍由父结点独占、访问次数仍按路径计，树的结构、换根与剪枝因此不受影响。
+      树并行与批量评估时结点的价值含有虚拟损失，不参与共享。
+    - 表在构造时按内存预算一次性分配，此后不再增长。
+    - 每个桶含两个槽位，由桶锁保护，可供树并行的多个线程同时访问。
+    - 替换顺序：同键的槽 > 空槽 > 此前回合写入的槽 > 命中与访问次数较少的槽。
+*/
+class TranspositionTable {
+public:
+    struct Entry {
+        std::uint64_t key = 0;
+        std::uint16_t generation = 0; // 最近写入的搜索回合，为0表示空槽
+        std::uint16_t hits = 0;       // 写入后评估结果被命中的次数
+        bool evaluated = false;       // 是否缓存了评估结果，即value与probs
+        float value = 0.0f;
+        std::uint32_t visits = 0;     // 共享统计量：各条路径上该局面的访问次数之和
+        float value_sum = 0.0f;       // 共享统计量：对应的价值之和，对于走到该局面的一方
+        float probs[BOARD_SIZE];
+    };
+
+    struct Bucket {
+        SpinLock guard;
+        Entry entries[2];
+    };
+
+    // bytes为内存预算，桶数取不超过预算的最大2的幂（至少为1）
+    explicit TranspositionTable(std::size_t bytes);
+
+    std::optional<Policy::EvalResult> load(std::uint64_t key);
+
+    void store(std::uint64_t key, const Policy::EvalResult& result);
+
+    // 将局面key的一次访问的价值value累计到共享统计量中，返回累计后的平均价值。
+    // 表中尚无该局面时，以结点自身的访问次数visits与平均价值mean（均已含本次访问）为初值。
+    float accumulate(std::uint64_t key, float value, std::size_t visits, float mean);
+
+    // 局面key的共享统计量<访问次数, 平均价值>，不计入查询次数
+    std::optional<std::pair<std::size_t, float>> shared(std::uint64_t key);
+
+    // 开始新一轮搜索，此前回合写入的槽位将优先被替换
+    void newSearch();
+
+    void clear();
+
+    std::size_t capacity() const { return 2 * (m_mask + 1); }
+
+    std::size_t memory() const { return (m_mask + 1) * sizeof(Bucket); }
+
+public:
+    std::atomic<std::size_t> m_probes = 0; // 查询次数
+    std::atomic<std::size_t> m_hits = 0;   // 命中次数
+
+private:
+    // 返回存放key的槽位：同键的槽，或按替换顺序选出并清空的槽。调用时须持有桶锁。
+    Entry& claim(Bucket& bucket, std::uint64_t key);
+
+    std::unique_ptr<Bucket[]> m_buckets;
+    std::size_t m_mask;
+    std::uint16_t m_generation = 1;
+};
+
+
+/*
+    按时间控制搜索时的时间管理器：
+    - 使用steady_clock，每次迭代都检查是否已达用时上限；读取根结点统计量的判断每c_checkInterval次迭代才进行一次。
+    - 设置了整局预算时，按预计剩余手数将剩余预算分摊到本回合，作为目标用时；每回合用时仍不超过MCTS的m_duration。
+      未设置时，目标用时即为m_duration。
+    - 提前终止：按当前的迭代速度，剩余时间内的迭代次数已不足以让访问次数第二多的子结点追上最多的子结点。
+    - 延长思考：到达目标用时，若前两名的访问次数之比不低于c_closeRatio，则继续搜索至c_extension倍的目标用时（不超过上限）。
+    shouldStop可被树并行的多个线程同时调用；一旦判定停止，之后的调用均返回true。
+    根并行时由汇总树的时间管理器统一判断：各棵树与之共用一个时间管理器，每c_checkInterval次迭代以report汇报
+    根结点统计量的增量，提前终止与延长思考均基于汇总后的统计量，而不各自在目标用时处停止。
+*/
+class TimeManager {
+public:
+    using Clock = std::chrono::steady_clock;
+
+    // 开始一回合的搜索。limit为本回合用时上限，moves为棋盘上已有的棋子数，root为搜索的根结点。
+    // begin为本回合的起始时刻，搜索前的换根与剪枝也计入用时。
+    void start(milliseconds limit, size_t moves, const Node* root, Clock::time_point begin = Clock::now());
+
+    // 是否应结束本回合的搜索。每次迭代前调用。启用汇报后使用汇总的统计量，不再读取root。
+    bool shouldStop(const Node* root);
+
+    // 各棵树向共用的时间管理器汇报所需的记录，由各树自己持有
+    struct Report {
+        std::vector<size_t> visits; // 上次汇报时各位置上子结点的访问次数
+        size_t root_visits = 0;     // 上次汇报时根结点的访问次数
+        size_t calls = 0;           // 距上次汇报的迭代次数
+    };
+
+    // 启用根并行时的汇报。须在start之前调用。
+    void enableReports();
+
+    // 开始一回合的汇报，root为汇报方的根结点。此前根结点上的子结点访问次数也计入汇总，根结点的访问次数则不计入。
+    void beginReport(const Node* root, Report& report) const;
+
+    // 由汇报方在每次迭代前调用，每c_checkInterval次将根结点统计量的增量计入汇总。只读取汇报方自己的树。
+    void report(const Node* root, Report& report);
+
+    // 结束一回合的搜索，从整局预算中扣除本回合的用时。
+    void finish();
+
+    // 设置整局的总预算，为0ms时表示不限制整局用时。同时重置剩余预算。
+    void setBudget(milliseconds budget);
+
+    void reset() { m_remaining = c_gameBudget; }
+
+public:
+    size_t c_checkInterval = C_CHECK_INTERVAL;
+    double c_closeRatio = 0.8;   // 前两名访问次数之比达到该值时视为接近
+    double c_extension = 2.0;    // 延长思考时，用时至多为目标用时的倍数
+    size_t c_minMovesLeft = 10;  // 分摊整局预算时，预计本方剩余手数的下限
+
+    milliseconds c_gameBudget = 0ms; // 整局的总预算
+    milliseconds m_remaining = 0ms;  // 整局剩余的预算
+    milliseconds m_target = 0ms;     // 本回合的目标用时
+    milliseconds m_limit = 0ms;      // 本回合的用时上限
+    milliseconds m_elapsed = 0ms;    // 上一回合的实际用时
+
+private:
+    Clock::time_point m_start;
+    size_t m_startVisits = 0;
+    std::atomic<size_t> m_calls = 0;
+    std::atomic<bool> m_stopped = false;
+
+    // 汇总的各位置上子结点的访问次数，以及本回合根结点新增的访问次数。未启用汇报时为空。
+    std::unique_ptr<std::atomic<size_t>[]> m_reportedVisits;
+    std::atomic<size_t> m_reportedDone = 0;
+};
+
+
+/*
+    一回合搜索的统计量，由MCTS在每回合开始时清零：
+    - 迭代次数、叶结点深度等计数每轮迭代都会记录，只是几次整数运算。
+    - 各阶段用时只在每C_SAMPLE_INTERVAL轮单线程迭代中测量一次，读取时钟的开销因此可以忽略；phaseTime将样本按迭代次数折算为估计的总用时。
+      树并行与批量评估时各阶段交错进行，不测量用时。
+    根并行时为各棵树的统计量之和。
+*/
+struct SearchStats {
+    enum Phase { Select, Expand, Simulate, BackPropogate, PhaseCount };
+
+    size_t playouts = 0;      // 本回合的迭代次数
+    size_t depth_sum = 0;     // 各轮迭代抵达的叶结点相对根结点的深度之和
+    size_t max_depth = 0;
+    size_t nodes_created = 0; // 本回合新增的结点数，含其后被剪去的结点
+    size_t pruned = 0;        // 本回合剪去的结点数
+    size_t reused_nodes = 0;  // 回合开始时换根后保留下来的结点数
+    size_t reused_visits = 0; // 回合开始时根结点的访问次数，即继承自此前回合的迭代
+    size_t root_visits = 0;   // 回合结束时根结点的访问次数
+    size_t evaluations = 0;   // 调用simulate（或batchSimulate中的一项）评估叶结点的次数，不含置换表命中
+    milliseconds duration = 0ms;
+
+    size_t sampled = 0;       // 测量了用时的迭代次数
+    std::chrono::nanoseconds phase_time[PhaseCount] = {};
+
+    void record(size_t depth) {
+        playouts += 1;
+        depth_sum += depth;
+        max_depth = std::max(max_depth, depth);
+    }
+
+    double averageDepth() const { return playouts ? double(depth_sum) / playouts : 0.0; }
+
+    // 回合结束时根结点的访问次数中继承自此前回合的比例
+    double reuseRatio() const { return root_visits ? double(reused_visits) / root_visits : 0.0; }
+
+    double playoutsPerSecond() const { return duration.count() ? playouts * 1000.0 / duration.count() : 0.0; }
+
+    std::chrono::nanoseconds phaseTime(Phase phase) const { 
+        return std::chrono::duration_cast<std::chrono::nanoseconds>(phase_time[phase] * (sampled ? double(playouts) / sampled : 0.0));
+    }
+
+    // 累加另一份统计量，用于汇总树并行的各线程与根并行的各棵树。深度取最大值，其余各项相加。
+    SearchStats& operator+=(const SearchStats& other);
+};
+
+// 按阶段累计用时的计时器，lap记录自上一次lap（或构造）以来的用时。未启用时不读取时钟。
+class PhaseTimer {
+public:
+    using Clock = std::chrono::steady_clock;
+
+    PhaseTimer(SearchStats& stats, bool enabled) : m_stats(stats), m_enabled(enabled) {
+        if (enabled) {
+            m_stats.sampled += 1;
+            m_last = Clock::now();
+        }
+    }
+
+    void lap(SearchStats::Phase phase) {
+        if (m_enabled) {
+            auto now = Clock::now();
+            m_stats.phase_time[phase] += now - m_last;
+            m_last = now;
+        }
+    }
+
+private:
+    SearchStats& m_stats;
+    bool m_enabled;
+    Clock::time_point m_last;
+};
+
+
 class MCTS {
 public:
+    /*
+        c_threads大于1时的并行方式：
+        - Tree: 多个线程共享同一棵树，要求Policy::isConcurrent()。
+        - Root: 每个线程各自搜索一棵独立的树（各持有一份Policy::clone()），搜索后汇总各树根结点的子结点统计量。
+                线程间没有任何共享状态，适用于带有缓存的策略。每棵树在各回合间各自复用。
+        Policy不满足对应要求时，退化为单线程搜索。
+    */
+    enum class Parallelism {
+        Tree, Root
+    };
+
     // 通过时间控制模拟迭代。为默认构造方法。
     MCTS(
         milliseconds c_duration  = C_DURATION,
         Position     last_move   = -1,
         Player       last_player = Player::White,
-        std::shared_ptr<Policy> policy = nullptr
+        std::shared_ptr<Policy> policy = nullptr,
+        size_t       c_threads   = 1,
+        Parallelism  c_parallelism = Parallelism::Tree,
+        size_t       c_batch     = 1,
+        size_t       c_table_size = 0,
+        size_t       c_node_budget = 0
     );
 
-    // 通过次数控制模拟迭代。
+    // 通过次数控制模拟迭代。根并行时，每棵树各自进行c_iterations次迭代。
     MCTS(
         size_t   c_iterations,
         Position last_move   = -1,
         Player   last_player = Player::White,
-        std::shared_ptr<Policy> policy = nullptr
+        std::shared_ptr<Policy> policy = nullptr,
+        size_t   c_threads   = 1,
+        Parallelism c_parallelism = Parallelism::Tree,
+        size_t   c_batch     = 1,
+        size_t   c_table_size = 0,
+        size_t   c_node_budget = 0
     );
 
+    // 等待所有后台释放线程结束
+    ~MCTS();
+
+    // 等待被丢弃的子树全部释放完毕。换根后需要准确的内存统计时调用。
+    void waitForRelease();
+
     Position getAction(Board& board);
     Policy::EvalResult evalState(Board& board); // Tree-policy的评估函数
     
     // 将蒙特卡洛树往深推进一层
-    Node* stepForward();                      // 选出子结点中的最好手
+    Node* stepForward();                      // 选出子结点中的最好手，已证明必胜的子结点优先
     Node* stepForward(Position next_move);    // 根据提供的动作往下走
 
     void syncWithBoard(Board& board); // 同步MCTS与棋盘，使得树的根节点为棋盘的最后一手
     void reset(); // 重置蒙特卡洛树与其所用的策略
 
+    // 剪去访问次数最少的子树，使结点数降至预算的3/4。被剪的结点保留自身统计量并成为叶结点，日后可被重新扩展。
+    // 访问次数自上而下单调不增，因此按阈值剪枝总是剪去完整的冷门子树；根结点及其子结点总被保留。
+    void prune();
+
+    // 根结点是否已被证明。单线程搜索与后台思考在根结点被证明后立即结束，stepForward随之选出必胜的着法。
+    bool solved() const { return m_root->proof != Node::Proof::None; }
+
+    // 后台思考：从棋盘对应的根结点持续搜索，直至stop被置位、根结点已被证明或结点数达到上限，返回迭代次数。
+    // 线程数与并行方式同正常回合的搜索：树并行时c_threads个线程共享本树，根并行时每棵树各占一个线程。
+    // 设置了结点数预算时按预算剪枝并持续搜索；未设置时结点数达到c_ponderBudget即停止。搜索期间不得在其他线程访问本树。
+    size_t ponder(Board& board, const std::atomic<bool>& stop);
+
+    /*
+        将整棵树以紧凑的二进制格式写入文件，board须为根结点对应的局面，成功时返回true。
+        供每回合重启进程的环境（如Botzone的非长时运行模式）在回合间保留搜索结果。
+        只保存Node自身的属性，派生结点的额外属性（如AMAF统计量）读回后从零开始。根并行时不支持。
+    */
+    bool save(const std::string& path, const Board& board) const;
+
+    // 读回save写入的树并推进至board对应的局面。文件不存在、已损坏或其着法记录不是board的前缀时不做改动，返回false。
+    bool load(const std::string& path, Board& board);
+
 private:
-    // 蒙特卡洛树的一轮迭代
+    // 以next_node为新的根结点，原根结点余下的部分交由release释放
+    Node* updateRoot(std::unique_ptr<Node> next_node);
+
+    // 在后台线程中释放被丢弃的子树，调用方无需等待析构。只回收已结束的释放线程，从不等待仍在进行的释放。
+    void release(std::unique_ptr<Node> node);
+
+    // 蒙特卡洛树的一轮迭代，返回新增的结点数
     size_t playout(Board& board);
 
+    // 创建根结点的第index个子结点（若为惰性扩展且尚未创建），并计入m_size
+    void materialize(size_t index);
+
+public:
+    // 与playout流程相同，但各步骤均静态绑定至PolicyT的成员函数，可被编译器内联。
+    template <class PolicyT>
+    static size_t StaticPlayout(MCTS& mcts, Board& board);
+
+private:
+
+    // 将终局结点标记为已证明并向上传播，见Default::Prove。只在单线程搜索中调用。
+    void prove(Node* node, Player winner);
+
+    // 将本轮迭代的价值沿路径累计到置换表的共享统计量中，并以累计后的平均价值更新各结点。
+    // node为叶结点，key为其局面的键值，value为其对于结点对应玩家的价值。只在单线程搜索中调用。
+    void shareStats(Node* node, std::uint64_t key, float value);
+
+    // 评估叶结点的局面：启用置换表时先查表，未命中再调用simulate并写入表中。
+    // StaticPlayout传入静态绑定的PolicyT::Simulate，其余路径传入Policy::simulate，二者为同一实现。调用次数计入stats。
+    template <class SimulateT>
+    Policy::EvalResult evaluate(Board& board, SimulateT&& simulate, SearchStats& stats);
+
+    // 加锁地从根结点选择至叶结点，并对沿途结点施加虚拟损失。树并行与批量评估共用。
+    Node* concurrentSelect(Board& board);
+
+    // 树并行下的一轮迭代，可由多个线程以各自的Board同时调用。expandable为false时只评估叶结点而不扩展。
+    // 迭代的计数记入stats，由调用线程各自持有。
+    size_t concurrentPlayout(Board& board, bool expandable, SearchStats& stats);
+
+    // 结点数是否仍在预算之内
+    bool underBudget(size_t size) const { return c_nodeBudget == 0 || size < c_nodeBudget; }
+
+    // 后台思考能否继续：设置了结点数预算时由剪枝控制结点数，否则以c_ponderBudget为上限
+    bool underPonderBudget(size_t size) const { return c_nodeBudget != 0 || c_ponderBudget == 0 || size < c_ponderBudget; }
+
+    // 按时间控制时是否应结束搜索。根并行的各棵树先向汇总树的时间管理器汇报，再由其判断。
+    bool timeUp();
+
+    // 批量评估：每轮收集至多c_batch个叶结点，一并评估后再逐个扩展与反向传播
+    void runBatchedPlayouts(Board& board);
+
     void runPlayouts(Board& board);
 
+    void runConcurrentPlayouts(Board& board);
+
+    // 根并行：为每个线程创建一棵独立的树
+    void createEnsemble();
+
+    void runEnsemblePlayouts(Board& board);
+
+    // 根并行：汇总各棵树根结点的子结点统计量，重建本树根结点的一层子结点
+    void mergeEnsemble();
+
 public:
     std::shared_ptr<Policy> m_policy;
     std::unique_ptr<Node> m_root;
-    size_t m_size; // FIXME: 由于unique_ptr的自动销毁，目前暂不能正确计数。
+    size_t m_size; // 树中存活的结点数。换根时减去被丢弃部分的结点数。根并行时还包括各棵树的结点数。
     size_t m_iterations;
     milliseconds m_duration;
+    size_t c_threads; // 并行搜索的线程数，为1时即单线程搜索
+    Parallelism c_parallelism;
+    size_t c_batch; // 批量评估的叶结点数，仅当Policy提供batchSimulate时生效；优先于树并行
+
+    /*
+        结点数预算，为0时不限制。
+        单线程搜索时，每轮迭代后若超出预算便调用prune，因此结点数至多超出一次扩展的数量。
+        树并行与批量评估时无法随时剪枝，超出预算后只评估不扩展，搜索结束后再剪枝。
+        根并行时各棵树平分预算。
+    */
+    size_t c_nodeBudget;
+
+    // 未设置结点数预算（c_nodeBudget为0）时，后台思考的结点数上限，为0时不限制。根并行时各棵树平分。
+    // 等待对手期间的搜索没有时间限制，不设上限可能耗尽评测环境的内存。
+    size_t c_ponderBudget = C_PONDER_BUDGET;
+
+    /*
+        确定性模式的种子，为空时不启用。启用后同一局面、同一棵初始树总是搜索出同一棵树，便于二分定位性能与棋力的变化：
+        - 每回合搜索开始时，以种子与局面的Zobrist键值为搜索线程的随机数引擎播种。
+        - 树并行退化为单线程搜索；根并行时第i棵树使用种子c_seed + i，在各自的线程中播种。
+        - Select与stepForward遇到并列时总是取下标最小的子结点（默认即是如此）。
+        按时间控制的搜索仍受时钟影响，须配合按次数控制的构造函数才能完全复现。
+    */
+    std::optional<std::uint64_t> c_seed;
+
+    // 置换表，构造时c_table_size（字节）为0则不启用。根并行时每棵树各自持有一份同样大小的表。
+    std::unique_ptr<TranspositionTable> m_table;
+
+    // 按时间控制时的时间管理器，m_duration为其每回合的用时上限。
+    // 根并行时由本树统一判断各棵树何时停止，各棵树自己的时间管理器不被使用。
+    TimeManager m_timer;
+
+    // 根并行时的各棵独立的树。本树此时只保存汇总后的一层结点。
+    std::vector<std::unique_ptr<MCTS>> m_ensemble;
+
+    // 最近一回合搜索的统计量
+    SearchStats m_stats;
 
 private:
     enum class Constraint {
         Iterations, Duration
     } c_constraint;
+
+    // 根并行时各棵树所用的汇总树的时间管理器，以及向其汇报的记录。不为根并行的成员时为空。
+    TimeManager* m_sharedTimer = nullptr;
+    TimeManager::Report m_report;
+
+    // 释放被丢弃子树的后台线程，done在释放完毕后置位。list保证元素地址不变，线程可安全地引用自己的done。
+    struct Reclaimer {
+        std::atomic<bool> done = false;
+        std::thread thread;
+    };
+    std::list<Reclaimer> m_reclaimers;
 };
 
+template <class SimulateT>
+Policy::EvalResult MCTS::evaluate(Board& board, SimulateT&& simulate, SearchStats& stats) {
+    if (!m_table || !m_policy->c_deterministic) {
+        return stats.evaluations += 1, simulate(board);
+    }
+    auto key = m_policy->hashKey(board); // simulate可能不还原棋盘，须在其之前取键值
+    if (auto cached = m_table->load(key)) {
+        return *cached;
+    }
+    stats.evaluations += 1;
+    auto result = simulate(board);
+    m_table->store(key, result);
+    return result;
+}
+
+template <class PolicyT>
+size_t MCTS::StaticPlayout(MCTS& mcts, Board& board) {
+    auto policy = static_cast<PolicyT*>(mcts.m_policy.get());
+    PhaseTimer timer(mcts.m_stats, mcts.m_stats.playouts % C_SAMPLE_INTERVAL == 0);
+    Node* node = mcts.m_root.get();
+    auto key = board.m_hash;
+    while (!node->isLeaf() && node->proof == Node::Proof::None) {
+        node = policy->PolicyT::Select(node);
+        policy->PolicyT::applyMove(board, node->position);
+        key ^= Board::ZobristKey(node->player, node->position) ^ Board::ZobristKey(Player::None);
+    }
+    mcts.m_stats.record(board.m_moveRecord.size() - policy->m_initActs);
+    timer.lap(SearchStats::Select);
+    double node_value;
+    size_t expand_size;
+    if (node->proof != Node::Proof::None) {
+        expand_size = 0;
+        node_value = node->state_value;
+    } else if (!policy->PolicyT::checkGameEnd(board)) {
+        auto [state_value, action_probs] = mcts.evaluate(board, [policy](Board& board) { return policy->PolicyT::Simulate(board); }, mcts.m_stats);
+        timer.lap(SearchStats::Simulate);
+        expand_size = policy->PolicyT::Expand(node, board, std::move(action_probs));
+        timer.lap(SearchStats::Expand);
+        node_value = -state_value;
+    } else {
+        expand_size = 0;
+        node_value = CalcScore(node->player, board.m_winner);
+        mcts.prove(node, board.m_winner);
+    }
+    policy->PolicyT::BackPropogate(node, board, node_value);
+    if (mcts.m_table) {
+        mcts.shareStats(node, key, node_value);
+    }
+    policy->PolicyT::revertMove(board, board.m_moveRecord.size() - policy->m_initActs);
+    timer.lap(SearchStats::BackPropogate);
+    return expand_size + policy->m_materialized.exchange(0, std::memory_order_relaxed);
+}
+
 }
 
 #endif // !GOMOKU_MCTS_H_
\ No newline at end of file
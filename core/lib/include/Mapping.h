@@ -68,21 +68,13 @@ public:
 public:
 	std::unique_ptr<Board> m_board;
 	std::array<std::string, 3 * (WIDTH + HEIGHT) - 2> m_lineMap;
-	std::uint64_t m_hash;
 };
 
 
 struct BoardHash {
-	// Zobristϣ洢//״̬
-	static const std::array<std::uint64_t[3], BOARD_SIZE> Zorbrist;
-	
-	static std::uint64_t HashPose(Position pose, Player player) {
-		return Zorbrist[pose.id][static_cast<int>(player) + 1];
-	}
-
-	// WARNING: 64λ뻷sizeof(size_t)Ϊ64λ
-	std::size_t operator()(const BoardMap& boardMap) {
-		return boardMap.m_hash;
+	// ZobristֵBoard::applyMove/revertMoveάBoard::m_hash
+	std::size_t operator()(const BoardMap& boardMap) const {
+		return std::hash<Board>()(*boardMap.m_board);
 	}
 };
 
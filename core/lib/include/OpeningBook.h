@@ -0,0 +1,105 @@
+#ifndef GOMOKU_OPENING_BOOK_H_
+#define GOMOKU_OPENING_BOOK_H_
+#include "Game.h"   // Gomoku::Position, Gomoku::Board
+#include <cstdint>  // std::uint64_t
+#include <vector>   // std::vector
+#include <map>      // std::map
+#include <string>   // std::string
+#include <memory>   // std::unique_ptr
+#include <utility>  // std::pair
+
+namespace Gomoku {
+
+struct Node;
+
+/*
+    开局库：以局面的Zobrist键值为索引，记录各局面下经过验证的着法及其权重与价值。
+    - 局面先按棋盘的对称变换规范化（正方形棋盘为8种，否则为4种），取各变换下键值最小者为规范键值，
+      着法亦以该变换下的坐标存储，因此对称的局面共用同一组记录。
+    - 文件为按(键值, 权重降序)排好的定长记录数组，以只读方式映射进内存，查询时二分查找，无需解析或分配。
+    - 键值表在编译期由固定种子生成，文件可跨进程、跨机器使用，但仅适用于相同尺寸的棋盘。
+    由OpeningBook::Builder离线生成：既可收录深度搜索的树，也可逐手收录对局棋谱。
+*/
+class OpeningBook {
+public:
+    // 文件中的一条记录
+    struct Entry {
+        std::uint64_t key;    // 局面的规范键值
+        std::uint32_t weight; // 着法的权重，一般为访问次数或出现次数
+        float value;          // 走该着法后的局面对于走棋方的平均价值
+        std::int16_t move;    // 规范变换下的着法
+        std::uint16_t reserved;
+    };
+
+    // 查询结果，着法已变换回实际局面的坐标
+    struct Move {
+        Position move;
+        std::uint32_t weight;
+        float value;
+    };
+
+    static constexpr int Symmetries = WIDTH == HEIGHT ? 8 : 4;
+
+    // 第symmetry种对称变换：依次为沿对角线转置（仅正方形棋盘）、左右翻转、上下翻转，由symmetry的各位决定。
+    static Position Transform(Position pose, int symmetry);
+
+    // Transform的逆变换
+    static Position Inverse(Position pose, int symmetry);
+
+    // 返回局面的<规范键值, 所用的对称变换>
+    static std::pair<std::uint64_t, int> CanonicalKey(const Board& board);
+
+    OpeningBook();
+    explicit OpeningBook(const std::string& path);
+    OpeningBook(const OpeningBook&) = delete;
+    OpeningBook& operator=(const OpeningBook&) = delete;
+    ~OpeningBook();
+
+    // 映射开局库文件，文件不存在、已损坏或棋盘尺寸不符时返回false，此时开局库为空。
+    bool open(const std::string& path);
+
+    void close();
+
+    bool isOpen() const { return m_entries != nullptr; }
+
+    std::size_t size() const { return m_count; }
+
+    // 查询局面下收录的着法，按权重从大到小排列。未收录时返回空数组。
+    std::vector<Move> probe(const Board& board) const;
+
+    class Builder;
+
+private:
+    struct Mapping; // 平台相关的文件映射句柄
+
+    std::unique_ptr<Mapping> m_mapping;
+    const Entry* m_entries = nullptr;
+    std::size_t m_count = 0;
+};
+
+// 开局库的离线生成器。同一局面的同一着法多次收录时，权重累加，价值按权重取平均。
+class OpeningBook::Builder {
+public:
+    // 收录局面board下的着法move
+    void add(const Board& board, Position move, std::size_t weight, float value);
+
+    // 收录以root为根的搜索树中访问次数不少于min_visits的结点，board为根结点对应的局面。
+    void addTree(const Node* root, Board& board, std::size_t min_visits);
+
+    // 写出开局库文件，成功时返回true
+    bool write(const std::string& path) const;
+
+    std::size_t size() const { return m_moves.size(); }
+
+private:
+    struct Stats {
+        double weight = 0;
+        double value_sum = 0; // 按权重加权的价值之和
+    };
+
+    std::map<std::pair<std::uint64_t, std::int16_t>, Stats> m_moves;
+};
+
+}
+
+#endif // !GOMOKU_OPENING_BOOK_H_
@@ -6,8 +6,10 @@
 #include "algorithms/Statistical.hpp"
 #include <algorithm>
 #include <tuple>
+#include <mutex>
 
 // Algorithms名空间是一组静态方法的集合，并不继承Policy。
+// 接收策略指针的方法以策略类型为模板参数：经由final的策略类调用时，其中的虚函数调用（如createNode）可被静态绑定。
 namespace Gomoku::Algorithms {
 
 struct Default {
@@ -27,21 +29,43 @@ struct Default {
         return c_puct * P_i * sqrt(N) / n_i;
     }
 
+    // 预取ptr所在的缓存行。
+    static void Prefetch(const void* ptr) {
+#if defined(_MSC_VER)
+        _mm_prefetch(static_cast<const char*>(ptr), _MM_HINT_T0);
+#elif defined(__GNUC__)
+        __builtin_prefetch(ptr);
+#endif
+    }
+
     // 获取当前可下点集的Mask Array。
-    static auto BoardMask(const Board& board) {
-        using namespace Eigen;
-        return Map<const Array<bool, -1, 1>>(board.moveStates(Player::None).data(), BOARD_SIZE);
+    static Eigen::Array<bool, -1, 1> BoardMask(const Board& board) {
+        Eigen::Array<bool, -1, 1> mask(BOARD_SIZE);
+        board.moveStates(Player::None).unpack(mask.data());
+        return mask;
+    }
+
+    // 获取邻域候选点集的Mask Array。候选集为空（如空棋盘）时退化为BoardMask。
+    static Eigen::Array<bool, -1, 1> CandidateMask(const Board& board) {
+        if (board.candidates().count() == 0) {
+            return BoardMask(board);
+        }
+        Eigen::Array<bool, -1, 1> mask(BOARD_SIZE);
+        board.candidates().unpack(mask.data());
+        return mask;
     }
 
-    // 随机下棋直到游戏结束。棋盘会保持结束状态。
-    static std::tuple<Player, int> RandomRollout(Board& board, bool revert = false) {
+    // 随机下棋直到游戏结束。若不回退，棋盘会保持结束状态；否则通过快照一次性恢复。
+    // nearby为真时只在邻域候选点中落子。
+    static std::tuple<Player, int> RandomRollout(Board& board, bool revert = false, bool nearby = false) {
+        auto snapshot = revert ? board.snapshot() : Board::Snapshot{};
         auto total_moves = 0;
         for (auto result = board.m_curPlayer; result != Player::None; ++total_moves) {
-            result = board.applyMove(board.getRandomMove());
+            result = board.applyMove(nearby ? board.getRandomCandidate() : board.getRandomMove());
         }
         auto winner = board.m_winner;
         if (revert) { 
-            board.revertMove(total_moves); 
+            board.restore(snapshot); 
         }
         return { winner, total_moves };
     }
@@ -54,56 +78,181 @@ struct Default {
         return action_probs;
     }
 
-    static Node* Select(Policy* policy, const Node* node) {
-        size_t max_index = 0;
-        double max_score = -1.0;
-        for (int i = 0; i < node->children.size(); ++i) {
-            auto child = node->children[i].get();
-            auto score = child->state_value + PUCB(child, policy->c_puct);
-            if (score > max_score) {
-                max_score = score, max_index = i;
-            }
+    // 返回邻域候选点集上的均匀概率分布，Expand时只会扩展邻域内的结点。
+    static Eigen::VectorXf CandidateProbs(Board& board) {
+        Eigen::VectorXf action_probs = CandidateMask(board).cast<float>();
+        action_probs /= action_probs.sum();
+
+        return action_probs;
+    }
+
+    // 在子结点统计量的SoA镜像上向量化地计算 Q + PUCB 并取最大者。sqrt(N)对所有子结点相同，只需计算一次。
+    // 选出的子结点将在下一轮Select中被访问，故提前预取其所在的缓存行。
+    // 惰性扩展的着法在此首次被选中时才创建结点，故需修改node的子结点集合（树并行时调用方已持有其锁）。
+    template <class PolicyT>
+    static Node* Select(PolicyT* policy, const Node* node) {
+        using Eigen::Map;
+        using Eigen::ArrayXf;
+        const auto n = static_cast<Eigen::Index>(node->children.size());
+        const auto factor = static_cast<float>(policy->c_puct * std::sqrt(static_cast<double>(node->node_visits)));
+        Map<const ArrayXf> P(node->childPriors(), n), Q(node->childValues(), n), N(node->childVisits(), n);
+        Eigen::Index max_index = 0;
+        (Q + factor * P / (N + 1.0f)).maxCoeff(&max_index);
+        auto child = node->children[max_index] ? node->children[max_index].get() : Materialize(policy, const_cast<Node*>(node), max_index);
+        Prefetch(child);
+        Prefetch(reinterpret_cast<const char*>(child) + sizeof(Node) - 1);
+        return child;
+    }
+
+    // 为惰性扩展的第i个着法创建子结点，其属性取自镜像。已创建时直接返回。
+    template <class PolicyT>
+    static Node* Materialize(PolicyT* policy, Node* node, size_t i) {
+        auto& slot = node->children[i];
+        if (!slot) {
+            slot = policy->createNode(node, node->childPosition(i), -node->player, node->childValues()[i], node->childPriors()[i]);
+            slot->node_visits = static_cast<size_t>(node->childVisits()[i]);
+            slot->index = static_cast<std::uint16_t>(i);
+            policy->m_materialized.fetch_add(1, std::memory_order_relaxed);
         }
-        return node->children[max_index].get();
+        return slot.get();
     }
 
     // 根据传入的概率扩张结点。概率为0的Action将不被加入子结点中。
-    static size_t Expand(Policy* policy, Node* node, Board& board, const Eigen::VectorXf action_probs, bool extraCheck = true) {
-        node->children.reserve(action_probs.size());
+    template <class PolicyT>
+    static size_t Expand(PolicyT* policy, Node* node, Board& board, const Eigen::VectorXf action_probs, bool extraCheck = true) {
+        node->children.reserve((action_probs.array() != 0.0f).count());
         for (int i = 0; i < BOARD_SIZE; ++i) {
             // 后一个条件是额外的检查，防止不允许下的点意外添进树中（概率不为0）。
             if (action_probs[i] != 0.0 && (!extraCheck || board.checkMove(i))) {
                 node->children.emplace_back(policy->createNode(node, i, -node->player, 0.0f, action_probs[i]));
             }
         }
+        node->buildStats();
         return node->children.size();
     }
 
-    // 进行1局随机游戏。
-    static Policy::EvalResult Simulate(Policy* policy, Board& board) {
+    // 惰性扩展：只在镜像中记录各着法的位置与先验概率，子结点留待Select首次选中时创建，返回值恒为0。
+    // 须与Default::Select配套使用。
+    template <class PolicyT>
+    static size_t LazyExpand(PolicyT* policy, Node* node, Board& board, const Eigen::VectorXf action_probs, bool extraCheck = true) {
+        std::vector<int> moves;
+        moves.reserve((action_probs.array() != 0.0f).count());
+        for (int i = 0; i < BOARD_SIZE; ++i) {
+            if (action_probs[i] != 0.0 && (!extraCheck || board.checkMove(i))) {
+                moves.push_back(i);
+            }
+        }
+        const auto n = moves.size();
+        node->children.resize(n);
+        node->child_stats.reset(new float[4 * n]());
+        for (size_t i = 0; i < n; ++i) {
+            node->child_stats[i] = action_probs[moves[i]];
+            node->child_stats[3 * n + i] = static_cast<float>(moves[i]);
+        }
+        return 0;
+    }
+
+    // 进行1局随机游戏。nearby为真时只在邻域候选点中落子，且只扩展邻域内的结点。
+    template <class PolicyT>
+    static Policy::EvalResult Simulate(PolicyT* policy, Board& board, bool nearby = false) {
         auto init_player = board.m_curPlayer;
-        auto [winner, total_moves] = RandomRollout(board);
-        board.revertMove(total_moves);
-        return { CalcScore(init_player, winner), UniformProbs(board) };
+        auto [winner, total_moves] = RandomRollout(board, true, nearby);
+        return { CalcScore(init_player, winner), nearby ? CandidateProbs(board) : UniformProbs(board) };
     }
 
-    static void BackPropogate(Policy* policy, Node* node, Board& board, float value) {
+    template <class PolicyT>
+    static void BackPropogate(PolicyT* policy, Node* node, Board& board, float value) {
         for (; node != nullptr; node = node->parent, value = -value) {
             node->node_visits += 1;
-            node->state_value += (value - node->state_value) / node->node_visits;
+            if (node->proof == Node::Proof::None) {
+                node->state_value += (value - node->state_value) / node->node_visits;
+            }
+            node->syncStats();
         }
     }
 
+    /*
+        MCTS-Solver：将终局结点标记为已证明，并按极小极大规则沿父结点向上传播。winner为终局的胜者，init_acts为根结点局面的着法数。
+        子结点中有必胜者，父结点即必败；所有子结点均已证明且无必胜者时，父结点必胜或和棋。
+        后者要求子结点覆盖父结点局面下的全部空位，因此只按候选着法扩展的策略只会证明必败，不会误判必胜。
+        空位数由结点深度推算，不依赖外部棋盘（带缓存的策略不在外部棋盘上落子）。
+    */
+    static void Prove(Node* node, Player winner, size_t init_acts) {
+        using Proof = Node::Proof;
+        size_t depth = 0;
+        for (auto ancestor = node->parent; ancestor != nullptr; ancestor = ancestor->parent) {
+            depth += 1;
+        }
+        node->prove(winner == Player::None ? Proof::Draw : winner == node->player ? Proof::Win : Proof::Loss);
+        for (size_t empty = BOARD_SIZE - init_acts - depth + 1; node->parent != nullptr; node = node->parent, ++empty) {
+            auto parent = node->parent; // 其局面下共有empty个空位
+            auto result = Proof::Loss;
+            if (node->proof != Proof::Win) {
+                if (parent->children.size() < empty) {
+                    return;
+                }
+                bool draw = false;
+                for (auto&& child : parent->children) {
+                    if (!child || child->proof == Proof::None || child->proof == Proof::Win) {
+                        return; // 有必胜的子结点时，父结点此前已被证明为必败
+                    }
+                    draw |= child->proof == Proof::Draw;
+                }
+                result = draw ? Proof::Draw : Proof::Win;
+            }
+            if (parent->proof == result) {
+                return;
+            }
+            parent->prove(result);
+        }
+    }
+
+    // 树并行时，对选中的结点施加虚拟损失：视作多了一次失败的访问。须在持有父结点锁时调用。
+    static void VirtualLoss(Node* node) {
+        node->node_visits += 1;
+        if (node->proof == Node::Proof::None) { // 与ConcurrentBackPropogate一致地跳过已证明的结点
+            node->state_value += (-1.0f - node->state_value) / node->node_visits;
+        }
+        node->syncStats();
+    }
+
+    // 树并行时的反向传播。路径上除根结点外都已施加过虚拟损失，只需将其中那次失败替换为真实价值，访问次数不变。
+    // 结点的统计量由其父结点的锁保护，根结点则由自身的锁保护。
+    static void ConcurrentBackPropogate(Node* node, float value) {
+        for (; node != nullptr; node = node->parent, value = -value) {
+            std::lock_guard<SpinLock> lock(node->parent ? node->parent->guard : node->guard);
+            if (node->parent != nullptr) {
+                if (node->proof == Node::Proof::None) {
+                    node->state_value += (value + 1.0f) / node->node_visits;
+                }
+            } else {
+                node->node_visits += 1;
+                if (node->proof == Node::Proof::None) {
+                    node->state_value += (value - node->state_value) / node->node_visits;
+                }
+            }
+            node->syncStats();
+        }
+    }
+
+	// 在镜像上加噪，再写回已创建的子结点，未创建的着法日后创建时自然取得加噪后的先验概率。
 	static void AddNoise(Node* node, float alpha = 0.05, float epsilon = 0.25) {
+		const auto n = node->children.size();
+		if (n == 0) {
+			return;
+		}
 		Eigen::VectorXf prior_probs;
 		prior_probs.setZero(BOARD_SIZE);
-		for (auto&& child : node->children) {
-			prior_probs[child->position] = child->action_prob;
+		for (size_t i = 0; i < n; ++i) {
+			prior_probs[node->childPosition(i)] = node->childPriors()[i];
 		}
 		prior_probs *= 1 - epsilon;
 		prior_probs += epsilon * Stats::DirichletNoise(prior_probs, alpha);
-		for (auto&& child : node->children) {
-			child->action_prob = prior_probs[child->position];
+		for (size_t i = 0; i < n; ++i) {
+			node->child_stats[i] = prior_probs[node->childPosition(i)];
+			if (auto& child = node->children[i]) {
+				child->action_prob = node->child_stats[i];
+			}
 		}
 	}
 
@@ -117,9 +266,8 @@ struct RAVE {
         float amaf_value = 0.0;
         size_t amaf_visits = 0;
 
-        // 目前MSVC(Visual Studio 2017 15.6)仍未支持Extended aggregate initialization，故需手动写一个构造函数
         AMAFNode(Node* parent = nullptr, Position pose = -1, Player player = Player::None, float Q = .0f, float P = .0f, float amaf_Q = .0f, size_t amaf_N = 0)
-            : Node{ parent, pose, player, Q, P }, amaf_value(amaf_Q), amaf_visits(amaf_N) { }
+            : Node(parent, pose, player, Q, P), amaf_value(amaf_Q), amaf_visits(amaf_N) { }
     };
 
     static double HandSelect(const AMAFNode* node, size_t eqv_param = 800) {
@@ -146,20 +294,24 @@ struct RAVE {
         Select与BackPropogate过程需要配套使用，并且并不一定需要AMAF结点，利用其不回退的机制也是很好的。
     */
 
-    static Node* Select(Policy* policy, const Node* node) {
+    template <class PolicyT>
+    static Node* Select(PolicyT* policy, const Node* node) {
         // 由于BackPropogate阶段已作过调整，只需取第一个值即可。
         return node->children[0].get();
     }
 
     // 反向传播更新结点价值，要求传入的Board处于游戏结束的状态。
-    template <bool UseRave = true>
-    static void BackPropogate(Policy* policy, Node* node, Board& board, float value, double c_bias = 0.0) {
+    template <bool UseRave = true, class PolicyT>
+    static void BackPropogate(PolicyT* policy, Node* node, Board& board, float value, double c_bias = 0.0) {
         for (; node != nullptr; node = node->parent, value = -value) {
             size_t max_index = 0;
             double max_score = -INFINITY;
             // 计算最终得分，当UseRave为真时，更新并使用子结点的RAVE价值
             for (int i = 0; i < node->children.size(); ++i) {
                 auto child_node = node->children[i].get();
+                if (child_node == nullptr) { // 惰性扩展尚未创建的子结点没有可更新的统计量
+                    continue;
+                }
                 auto score = Default::PUCB(child_node, policy->c_puct);
                 if constexpr (UseRave) {
                     auto rave_node = static_cast<AMAFNode*>(child_node);
@@ -171,15 +323,21 @@ struct RAVE {
                 } else {
                     score += child_node->state_value;
                 }
+                if (child_node->proof == Node::Proof::Win || child_node->proof == Node::Proof::Loss) {
+                    score = child_node->mirrorValue(); // 与Default::Select一致：总是选中必胜者，避开必败者
+                }
                 if (score > max_score) {
                     max_score = score, max_index = i;
                 }
             }
             if (!node->children.empty()) {
-                node->children[0].swap(node->children[max_index]); // 得分最大的子结点提升至容器首位
+                node->swapChildren(0, max_index); // 得分最大的子结点提升至容器首位
             }
             node->node_visits += 1;
-            node->state_value += (value - node->state_value) / node->node_visits;
+            if (node->proof == Node::Proof::None) {
+                node->state_value += (value - node->state_value) / node->node_visits;
+            }
+            node->syncStats();
         }
     }
 
@@ -1,5 +1,6 @@
 #ifndef GOMOKU_ALGORITHMS_STATISTICAL_H_
 #define GOMOKU_ALGORITHMS_STATISTICAL_H_
+#include "../Game.h"
 #include <random>
 #include <Eigen/Dense>
 
@@ -19,10 +20,9 @@ struct Stats {
         return exp_logits / exp_logits.sum();
     }
 
-	// 32位随机数发生器
+	// 当前线程的随机数发生器
 	static auto& RandomEngine() {
-		static std::mt19937 engine(std::random_device{}());
-		return engine;
+		return Gomoku::RandomEngine::Local();
 	}
 
 	// 参考: https://en.wikipedia.org/wiki/Dirichlet_distribution#Random_number_generation
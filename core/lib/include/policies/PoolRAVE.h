@@ -1,31 +1,42 @@
 #ifndef GOMOKU_POLICY_POOLRAVE_H_
 #define GOMOKU_POLICY_POOLRAVE_H_
-#include "../algorithms/MonteCarlo.hpp"
+#include "Static.h"
 
 namespace Gomoku::Policies {
 
-class PoolRAVEPolicy : public Policy {
+class PoolRAVEPolicy final : public StaticPolicy<PoolRAVEPolicy> {
 public:
     using Default = Gomoku::Algorithms::Default; // 引入默认算法
     using RAVE = Gomoku::Algorithms::RAVE; // 引入RAVE算法
     using AMAFNode = RAVE::AMAFNode; // 选择AMAFNode作为结点类型
 
-    PoolRAVEPolicy(double c_puct = 1e-4, double c_bias = 1e-1) :
-        Policy(
-            [this](auto node) { return RAVE::Select(this, node); },
-            [this](auto node, auto& board, auto probs) { return Default::Expand(this, node, board, std::move(probs), false); }, // 不进行额外有效性检查
-            [this](auto& board) { return defaultSimulate(board); },
-            [this](auto node, auto& board, auto value) { return RAVE::BackPropogate(this, node, board, value, this->c_bias); },
-            c_puct), c_bias(c_bias) {
+    PoolRAVEPolicy(double c_puct = 1e-4, double c_bias = 1e-1, bool c_nearby = false) :
+        StaticPolicy(c_puct), c_bias(c_bias), c_nearby(c_nearby) {
 
     }
 
-    virtual std::unique_ptr<Node> createNode(Node* parent, Position pose, Player player, float value, float prob) {
+    Node* Select(const Node* node) {
+        return RAVE::Select(this, node);
+    }
+
+    size_t Expand(Node* node, Board& board, const Eigen::VectorXf action_probs) {
+        return Default::Expand(this, node, board, std::move(action_probs), false); // 不进行额外有效性检查
+    }
+
+    void BackPropogate(Node* node, Board& board, float value) {
+        RAVE::BackPropogate(this, node, board, value, c_bias);
+    }
+
+    virtual std::unique_ptr<Node> createNode(Node* parent, Position pose, Player player, float value, float prob) override {
         return std::unique_ptr<Node>(new AMAFNode{ parent, pose, player, value, prob });
     }
 
-    EvalResult defaultSimulate(Board& board) {
-        auto action_probs = Default::UniformProbs(board); // 先求出概率，因为Rollout后Board不会被还原
+    virtual std::shared_ptr<Policy> clone() const override {
+        return std::make_shared<PoolRAVEPolicy>(c_puct, c_bias, c_nearby);
+    }
+
+    EvalResult Simulate(Board& board) {
+        auto action_probs = c_nearby ? Default::CandidateProbs(board) : Default::UniformProbs(board); // 先求出概率，因为Rollout后Board不会被还原
         auto init_player = board.m_curPlayer;
 
         //float final_score = 0;
@@ -43,12 +54,13 @@ public:
         //final_score /= rollout_count;
         //return { final_score, action_probs };
 
-        auto [winner, _] = Default::RandomRollout(board);
+        auto [winner, _] = Default::RandomRollout(board, false, c_nearby);
         return { CalcScore(init_player, winner), action_probs };
     }
 
 public:
     double c_bias;
+    bool c_nearby; // 是否只在邻域候选点中随机下棋，并只扩展邻域内的结点
 };
 
 }
@@ -0,0 +1,55 @@
+#ifndef GOMOKU_POLICY_STATIC_H_
+#define GOMOKU_POLICY_STATIC_H_
+#include "../MCTS.h"
+#include "../algorithms/MonteCarlo.hpp"
+
+namespace Gomoku::Policies {
+
+/*
+    编译期拼装的策略基类（CRTP）：
+    ① 派生类以同名成员函数Select/Expand/Simulate/BackPropogate覆盖所需的步骤，未覆盖的步骤使用默认算法。
+       applyMove等虚函数照常覆盖即可。派生类应声明为final。
+    ② 单线程搜索时，MCTS经由Policy::playoutKernel调用MCTS::StaticPlayout<Derived>，各步骤均为静态绑定。
+    ③ 基类的四个std::function固定转发至上述成员函数，供树并行、批量评估与Python等外部调用者使用，
+       因此各条搜索路径的行为一致。
+*/
+template <class Derived>
+class StaticPolicy : public Policy {
+public:
+    using Default = Algorithms::Default; // 引入默认算法
+
+    StaticPolicy(double c_puct = C_PUCT) :
+        Policy(
+            [this](auto node)                          { return derived()->Select(node); },
+            [this](auto node, auto& board, auto probs) { return derived()->Expand(node, board, std::move(probs)); },
+            [this](auto& board)                        { return derived()->Simulate(board); },
+            [this](auto node, auto& board, auto value) { return derived()->BackPropogate(node, board, value); },
+            c_puct) {
+        playoutKernel = &MCTS::StaticPlayout<Derived>;
+        c_deterministic = false; // 默认的Simulate为随机Rollout；评估确定的派生类应在构造时置为true
+    }
+
+    Node* Select(const Node* node) {
+        return Default::Select(derived(), node);
+    }
+
+    // 默认的Select与BackPropogate支持惰性扩展；覆盖二者之一的派生类若仍需默认扩展，应一并覆盖Expand并使用Default::Expand。
+    size_t Expand(Node* node, Board& board, const Eigen::VectorXf action_probs) {
+        return Default::LazyExpand(derived(), node, board, std::move(action_probs));
+    }
+
+    EvalResult Simulate(Board& board) {
+        return Default::Simulate(derived(), board);
+    }
+
+    void BackPropogate(Node* node, Board& board, float value) {
+        Default::BackPropogate(derived(), node, board, value);
+    }
+
+private:
+    Derived* derived() { return static_cast<Derived*>(this); }
+};
+
+}
+
+#endif // !GOMOKU_POLICY_STATIC_H_
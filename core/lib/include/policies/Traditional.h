@@ -1,27 +1,42 @@
 #ifndef GOMOKU_POLICY_TRADITIONAL_H_
 #define GOMOKU_POLICY_TRADITIONAL_H_
-#include "../MCTS.h"
+#include "Static.h"
 #include "../Pattern.h"
-#include "../algorithms/MonteCarlo.hpp"
 #include "../algorithms/Heuristic.hpp"
 
 namespace Gomoku::Policies {
 
 // 在该Policy下，原Board除了棋盘状态外，不下任何一子，由内部维护的棋盘进行代理。
-class TraditionalPolicy : public Policy {
+class TraditionalPolicy final : public StaticPolicy<TraditionalPolicy> {
 public:
     using Default = Algorithms::Default; // 引入默认算法
     using RAVE = Algorithms::RAVE; // 引入RAVE算法的Select与BackPropogate策略（对缓存友好）
     using Heuristic = Algorithms::Heuristic; // 引入人工算法
 
     TraditionalPolicy(double puct = C_PUCT) :
-        Policy(
-            [this](auto node)                          { return RAVE::Select(this, node); },
-            [this](auto node, auto& board, auto probs) { return Default::Expand(this, node, m_evaluator.board(), std::move(probs), false); },
-            [this](auto& board)                        { return hybridSimulate(m_evaluator.board()); },
-            [this](auto node, auto& board, auto value) { return RAVE::BackPropogate<false>(this, node, m_evaluator.board(), value); },
-            puct) {
+        StaticPolicy(puct) {
+        c_deterministic = true; // 评估只依赖局面的棋型，不含随机Rollout
+    }
+
+    Node* Select(const Node* node) {
+        return RAVE::Select(this, node);
+    }
 
+    size_t Expand(Node* node, Board& board, const Eigen::VectorXf action_probs) {
+        return Default::Expand(this, node, m_evaluator.board(), std::move(action_probs), false);
+    }
+
+    EvalResult Simulate(Board& board) {
+        return hybridSimulate(m_evaluator.board());
+    }
+
+    void BackPropogate(Node* node, Board& board, float value) {
+        RAVE::BackPropogate<false>(this, node, m_evaluator.board(), value);
+    }
+
+    // 每个副本持有独立的Evaluator，因此可在根并行时各自使用
+    virtual std::shared_ptr<Policy> clone() const override {
+        return std::make_shared<TraditionalPolicy>(c_puct);
     }
 
     virtual void prepare(Board& board) override {
@@ -30,6 +45,10 @@ public:
         m_cachedActs = m_initActs; // 视初始状态时已下的棋为已缓存
     }
 
+    virtual std::uint64_t hashKey(Board& board) override {
+        return m_evaluator.board().m_hash;
+    }
+
     virtual Player applyMove(Board& board, Position move) override {
         return Heuristic::CachedApplyMove(board, move, m_evaluator, m_cachedActs);
     }
@@ -2,31 +2,221 @@
 #include <string>
 #include <sstream>
 #include <random>
+#include <algorithm>
+#include <thread>
+#if defined(GOMOKU_ENABLE_AVX2) && (defined(__x86_64__) || defined(__i386__) || defined(_M_X64) || defined(_M_IX86))
+#define GOMOKU_AVX2_KERNEL
+#include <immintrin.h> // _mm_srlv_epi32, _mm_testz_si128
+#if defined(_MSC_VER)
+#include <intrin.h>    // __cpuid, __cpuidex, _xgetbv
+#define GOMOKU_TARGET_AVX2
+#else
+#define GOMOKU_TARGET_AVX2 __attribute__((target("avx2")))
+#endif
+#endif
 
 using namespace std;
 using Eigen::VectorXf;
 
 namespace Gomoku {
 
-static uniform_int_distribution<unsigned> rnd(0, BOARD_SIZE - 1); // 注意区间是[a, b]!
-static mt19937 rnd_eng((random_device())());
 static ostringstream oss;
 
+/* ------------------- RandomEngine类实现 ------------------- */
+
+RandomEngine& RandomEngine::Local() {
+    thread_local RandomEngine engine(
+        (static_cast<std::uint64_t>(random_device{}()) << 32) ^ hash<thread::id>()(this_thread::get_id())
+    );
+    return engine;
+}
+
 /* ------------------- Position类实现 ------------------- */
 
 const Position Position::npos = -1;
 
+/* ------------------- 连珠检测实现 ------------------- */
+
+// 直线位图两端的空位数
+constexpr int LINE_PADDING = MAX_RENJU - 1;
+
+// 以最后一手为中心的检测窗口，覆盖其两侧各MAX_RENJU-1格
+constexpr std::uint32_t RENJU_WINDOW = (1u << (2 * MAX_RENJU - 1)) - 1;
+
+static_assert(std::max<int>(WIDTH, HEIGHT) + 2 * LINE_PADDING <= 32, "A padded line must fit in 32 bits.");
+
+// 格子所在直线的下标，以及格子在直线上的偏移（不含两端空位）
+struct LineIndex { 
+    std::uint16_t line, offset; 
+};
+
+// 每个格子在 横、竖、左上-右下、右上-左下 四个方向上的直线索引表
+static constexpr auto LineIndices = []() {
+    std::array<std::array<LineIndex, 4>, BOARD_SIZE> indices = {};
+    for (int id = 0; id < BOARD_SIZE; ++id) {
+        const int x = id % WIDTH, y = id / WIDTH;
+        indices[id][0] = { std::uint16_t(y), std::uint16_t(x) };
+        indices[id][1] = { std::uint16_t(HEIGHT + x), std::uint16_t(y) };
+        indices[id][2] = { std::uint16_t(WIDTH + 2 * HEIGHT - 1 + x - y), std::uint16_t(std::min(x, y)) };
+        indices[id][3] = { std::uint16_t(2 * (WIDTH + HEIGHT) - 1 + x + y), std::uint16_t(std::min(WIDTH - 1 - x, y)) };
+    }
+    return indices;
+}();
+
+// 翻转move在四条直线上对应的位。下棋与悔棋共用。
+inline void flipLines(std::uint32_t* lines, Position move) {
+    for (const auto [line, offset] : LineIndices[move]) {
+        lines[line] ^= 1u << (offset + LINE_PADDING);
+    }
+}
+
+// 检测四个方向的窗口内是否存在MAX_RENJU连珠。
+// 由于只有最后一手可能新构成连珠，而窗口以最后一手为中心，窗口内的任意连珠都必然经过最后一手。
+inline void loadWindows(const std::uint32_t* lines, Position move, std::uint32_t* targets, std::uint32_t* offsets) {
+    for (int i = 0; i < 4; ++i) {
+        targets[i] = lines[LineIndices[move][i].line];
+        offsets[i] = LineIndices[move][i].offset;
+    }
+}
+
+static bool hasRenjuScalar(const std::uint32_t* lines, Position move) {
+    std::uint32_t targets[4], offsets[4];
+    loadWindows(lines, move, targets, offsets);
+    std::uint32_t renju = 0;
+    for (int i = 0; i < 4; ++i) {
+        const auto window = (targets[i] >> offsets[i]) & RENJU_WINDOW;
+        auto run = window;
+        for (int j = 1; j < MAX_RENJU; ++j) {
+            run &= window >> j;
+        }
+        renju |= run;
+    }
+    return renju != 0;
+}
+
+#if defined(GOMOKU_AVX2_KERNEL)
+// 四个方向各占一条32位通道，以可变移位对齐各自的窗口后，一并进行移位-与运算。
+// 只有本函数以AVX2编译，其余代码（包括Eigen）仍可运行于不支持AVX2的处理器。
+GOMOKU_TARGET_AVX2 static bool hasRenjuAVX2(const std::uint32_t* lines, Position move) {
+    alignas(16) std::uint32_t targets[4], offsets[4];
+    loadWindows(lines, move, targets, offsets);
+    const auto windows = _mm_and_si128(
+        _mm_srlv_epi32(_mm_load_si128((const __m128i*)targets), _mm_load_si128((const __m128i*)offsets)),
+        _mm_set1_epi32(RENJU_WINDOW)
+    );
+    auto renju = windows;
+    for (int i = 1; i < MAX_RENJU; ++i) {
+        renju = _mm_and_si128(renju, _mm_srl_epi32(windows, _mm_cvtsi32_si128(i)));
+    }
+    return !_mm_testz_si128(renju, renju);
+}
+
+// 运行时检测处理器（及操作系统）是否支持AVX2
+static bool SupportsAVX2() {
+#if defined(__AVX2__)
+    return true; // 整体以AVX2编译时无需检测
+#elif defined(_MSC_VER)
+    int info[4];
+    __cpuid(info, 0);
+    if (info[0] < 7) {
+        return false;
+    }
+    __cpuid(info, 1);
+    if (!(info[2] & (1 << 27)) || (_xgetbv(0) & 0x6) != 0x6) { // OSXSAVE，且操作系统保存YMM寄存器
+        return false;
+    }
+    __cpuidex(info, 7, 0);
+    return (info[1] & (1 << 5)) != 0;
+#else
+    return __builtin_cpu_supports("avx2");
+#endif
+}
+
+static const bool HasAVX2 = SupportsAVX2();
+#endif
+
+inline bool hasRenju(const std::uint32_t* lines, Position move) {
+#if defined(GOMOKU_AVX2_KERNEL)
+    if (HasAVX2) {
+        return hasRenjuAVX2(lines, move);
+    }
+#endif
+    return hasRenjuScalar(lines, move);
+}
+
+/* ------------------- Zobrist键值实现 ------------------- */
+
+// 键值表：前2*BOARD_SIZE项按 { Black, White } 交错存放各格子的键值，末项为轮换应下方的键值。
+// 以固定种子的SplitMix64在编译期生成，保证不同进程间的键值一致。
+static constexpr auto ZobristKeys = []() {
+    std::array<std::uint64_t, 2 * BOARD_SIZE + 1> keys = {};
+    std::uint64_t seed = 0x476f6d6f6b75ull; // "Gomoku"
+    for (auto& key : keys) {
+        std::uint64_t z = (seed += 0x9e3779b97f4a7c15ull);
+        z = (z ^ (z >> 30)) * 0xbf58476d1ce4e5b9ull;
+        z = (z ^ (z >> 27)) * 0x94d049bb133111ebull;
+        key = z ^ (z >> 31);
+    }
+    return keys;
+}();
+
+std::uint64_t Board::ZobristKey(Player player, Position pose) {
+    return player == Player::None ? ZobristKeys.back() : ZobristKeys[2 * pose.id + (player == Player::White)];
+}
+
 /* ------------------- Board类实现 ------------------- */
 
 // 由于是内联使用，不暴露成外部接口，因此无需进行额外参数检查，下同
 inline void setState(Board* board, Player player, Position position) {
-    board->moveStates(player)[position] = true;
-    board->moveCounts(player) += 1;
+    board->moveStates(player).set(position);
+    if (player != Player::None) {
+        flipLines(board->lineStates(player), position);
+    }
 }
 
 inline void unsetState(Board* board, Player player, Position position) {
-    board->moveStates(player)[position] = false;
-    board->moveCounts(player) -= 1;
+    board->moveStates(player).reset(position);
+    if (player != Player::None) {
+        flipLines(board->lineStates(player), position);
+    }
+}
+
+// 将move与空位列表的末位交换，使其移出空位列表边界。须在棋谱记录move之前调用。
+inline void removeEmpty(Board* board, Position move) {
+    const auto last = BOARD_SIZE - 1 - board->m_moveRecord.size();
+    const auto index = board->m_emptyIndices[move];
+    const auto other = board->m_emptyCells[last];
+    std::swap(board->m_emptyCells[index], board->m_emptyCells[last]);
+    board->m_emptyIndices[other] = index;
+    board->m_emptyIndices[move] = static_cast<short>(last);
+}
+
+// 落子后，将move邻域内各格子的棋子计数加一，并将新进入邻域的空位加入候选集。须在move被标记为非空之后调用。
+inline void addNeighbors(Board* board, Position move) {
+    for (int y = std::max(move.y() - CANDIDATE_RANGE, 0); y <= std::min(move.y() + CANDIDATE_RANGE, HEIGHT - 1); ++y) {
+        for (int x = std::max(move.x() - CANDIDATE_RANGE, 0); x <= std::min(move.x() + CANDIDATE_RANGE, WIDTH - 1); ++x) {
+            const Position pose(x, y);
+            if (board->m_neighborCounts[pose]++ == 0 && board->moveState(Player::None, pose)) {
+                board->m_candidates.set(pose);
+            }
+        }
+    }
+    board->m_candidates.reset(move);
+}
+
+// 悔棋后，将move邻域内各格子的棋子计数减一，并移出离开邻域的格子；move本身若仍在其他棋子的邻域内则放回。
+inline void removeNeighbors(Board* board, Position move) {
+    for (int y = std::max(move.y() - CANDIDATE_RANGE, 0); y <= std::min(move.y() + CANDIDATE_RANGE, HEIGHT - 1); ++y) {
+        for (int x = std::max(move.x() - CANDIDATE_RANGE, 0); x <= std::min(move.x() + CANDIDATE_RANGE, WIDTH - 1); ++x) {
+            const Position pose(x, y);
+            if (--board->m_neighborCounts[pose] == 0) {
+                board->m_candidates.reset(pose);
+            }
+        }
+    }
+    if (board->m_neighborCounts[move] != 0) {
+        board->m_candidates.set(move);
+    }
 }
 
 Board::Board() {
@@ -39,6 +229,9 @@ Player Board::applyMove(Position move, bool checkVictory) {
     if (m_curPlayer != Player::None && checkMove(move)) {
         setState(this, m_curPlayer, move);
         unsetState(this, Player::None, move);
+        removeEmpty(this, move);
+        addNeighbors(this, move);
+        m_hash ^= ZobristKey(m_curPlayer, move) ^ ZobristKey(Player::None);
         m_moveRecord.push_back(move);
         m_curPlayer = -m_curPlayer;
         if (checkVictory) { checkGameEnd(); }
@@ -55,6 +248,8 @@ Player Board::revertMove(size_t count) {
     for (size_t i = 0; !m_moveRecord.empty() && i < count; ++i) {
         unsetState(this, -m_curPlayer, m_moveRecord.back());
         setState(this, Player::None, m_moveRecord.back());
+        removeNeighbors(this, m_moveRecord.back());
+        m_hash ^= ZobristKey(-m_curPlayer, m_moveRecord.back()) ^ ZobristKey(Player::None);
         m_moveRecord.pop_back();
         m_curPlayer = -m_curPlayer;
     }
@@ -62,19 +257,24 @@ Player Board::revertMove(size_t count) {
 }
 
 Position Board::getRandomMove() const {
-    if (moveCounts(Player::None) == 0) {
+    const auto empty_count = BOARD_SIZE - m_moveRecord.size();
+    if (empty_count == 0) {
         throw overflow_error("board is already full");
     }
-    int id = rnd(rnd_eng);
-    while (!moveState(Player::None, id)) {
-        id = (id + 1) % moveStates(Player::None).size();
+    return m_emptyCells[RandomEngine::Local().bounded(static_cast<std::uint32_t>(empty_count))];
+}
+
+Position Board::getRandomCandidate() const {
+    const auto candidate_count = m_candidates.count();
+    if (candidate_count == 0) {
+        return getRandomMove();
     }
-    return Position(id);
+    return m_candidates.nth(RandomEngine::Local().bounded(static_cast<std::uint32_t>(candidate_count)));
 }
 
 Position Board::getRandomMove(Eigen::Ref<VectorXf> probs) const {
     auto distribution = discrete_distribution<int>(probs.data(), probs.data() + probs.size());
-    return distribution(rnd_eng);
+    return distribution(RandomEngine::Local());
 }
 
 bool Board::checkMove(Position move) const {
@@ -96,33 +296,10 @@ bool Board::checkGameEnd() {
         return false;
     }
 
-    // 获取最后一手的坐标
-    //const auto [curX, curY] = m_moveRecord.back();
-    const auto curX = m_moveRecord.back().x();
-    const auto curY = m_moveRecord.back().y();
+    // 最后一手的玩家，只需在其直线位图上检测以最后一手为中心的窗口
     const auto lastPlayer = -m_curPlayer;
 
-    // 沿不同方向的搜索方法复用
-    const auto search = [curX, curY, lastPlayer, this](int dx, int dy) {
-        int renju = 1; // 当前落子构成的最大连珠数
-
-        // 正向与反向搜索
-        for (int sgn : {1, -1}) {
-            int x = curX, y = curY;
-            for (int i = 1; i <= MAX_RENJU; ++i) {
-                x += sgn * dx, y += sgn * dy;
-                // 判断坐标的格子是否未越界且归属为当前棋子
-                if (checkBoundary(x, y) && 
-                    moveState(lastPlayer, {x, y})) ++renju;
-                else break;
-            }
-        }
-
-        return renju >= MAX_RENJU;
-    };
-
-    // 从 左->右 || 下->上 || 左上->右下 || 左下->右上 进行搜索
-    if (search(1, 0) || search(0, 1) || search(1, -1) || search(1, 1)) {
+    if (hasRenju(lineStates(lastPlayer), m_moveRecord.back())) {
         m_winner = lastPlayer; // 赢家为下最后一手的玩家
         m_curPlayer = Player::None;
         return true;
@@ -138,13 +315,86 @@ bool Board::checkGameEnd() {
 void Board::reset() {
     for (auto player : { Player::Black, Player::None, Player::White }) {
         moveStates(player).fill(player == Player::None ? true : false);
-        moveCounts(player) = (player == Player::None ? GameConfig::BOARD_SIZE : 0);
     }
+    for (auto& lines : m_lineStates) {
+        std::fill(begin(lines), end(lines), 0u);
+    }
+    for (int i = 0; i < BOARD_SIZE; ++i) {
+        m_emptyCells[i] = i;
+        m_emptyIndices[i] = i;
+    }
+    m_candidates.fill(false);
+    m_neighborCounts.fill(0);
     m_moveRecord.clear();
+    m_hash = 0;
     m_curPlayer = Player::Black;
     m_winner = Player::None;
 }
 
+Board::Snapshot Board::snapshot() const {
+    Snapshot snapshot;
+    std::copy(begin(m_moveStates), end(m_moveStates), begin(snapshot.moveStates));
+    std::copy(&m_lineStates[0][0], &m_lineStates[0][0] + 2 * LINE_COUNT, &snapshot.lineStates[0][0]);
+    snapshot.candidates = m_candidates;
+    std::copy(begin(m_neighborCounts), end(m_neighborCounts), begin(snapshot.neighborCounts));
+    snapshot.curPlayer = m_curPlayer;
+    snapshot.winner = m_winner;
+    snapshot.hash = m_hash;
+    snapshot.records = m_moveRecord.size();
+    return snapshot;
+}
+
+void Board::restore(const Snapshot& snapshot) {
+    std::copy(begin(snapshot.moveStates), end(snapshot.moveStates), begin(m_moveStates));
+    std::copy(&snapshot.lineStates[0][0], &snapshot.lineStates[0][0] + 2 * LINE_COUNT, &m_lineStates[0][0]);
+    m_candidates = snapshot.candidates;
+    std::copy(begin(snapshot.neighborCounts), end(snapshot.neighborCounts), begin(m_neighborCounts));
+    m_curPlayer = snapshot.curPlayer;
+    m_winner = snapshot.winner;
+    m_hash = snapshot.hash;
+    m_moveRecord.resize(snapshot.records); // Position可平凡析构，截断棋谱不会产生额外开销；空位列表的边界也随之恢复
+}
+
+/* ------------------- CompactBoard类实现 ------------------- */
+
+CompactBoard::CompactBoard(const Board& board) : curPlayer(board.m_curPlayer) {
+    for (auto player : { Player::Black, Player::White }) {
+        const auto& words = board.moveStates(player).words;
+        auto& plane = planes[player == Player::White];
+        for (int i = 0; i < PlaneBytes; ++i) {
+            plane[i] = static_cast<std::uint8_t>(words[i >> 3] >> ((i & 7) << 3));
+        }
+    }
+    for (size_t i = 0; i < 2 && i < board.m_moveRecord.size(); ++i) {
+        lastMoves[i] = board.m_moveRecord.rbegin()[i];
+    }
+}
+
+Board CompactBoard::toBoard() const {
+    std::vector<Position> moves[2]; // { Black, White }
+    for (int id = 0; id < BOARD_SIZE; ++id) {
+        for (auto player : { Player::Black, Player::White }) {
+            if (test(player, id) && id != lastMoves[0] && id != lastMoves[1]) {
+                moves[player == Player::White].push_back(id);
+            }
+        }
+    }
+    for (int i = 1; i >= 0; --i) { // 最后两手放在各自玩家序列的末尾
+        if (lastMoves[i] != Position::npos) {
+            moves[test(Player::White, lastMoves[i])].push_back(lastMoves[i]);
+        }
+    }
+    Board board;
+    for (size_t i = 0; i < moves[0].size(); ++i) {
+        board.applyMove(moves[0][i], false);
+        if (i < moves[1].size()) {
+            board.applyMove(moves[1][i], false);
+        }
+    }
+    board.checkGameEnd();
+    return board;
+}
+
 #pragma optimize("", off)
 string Board::toString() const {
     return std::to_string(*this);
@@ -180,7 +430,7 @@ string std::to_string(const Board& board) {
     oss.str("");
     for (int i : {0, 1, 2}) {
         for (int j = 0; j < WIDTH * HEIGHT; ++j) {
-            positions[j] = board.m_moveStates[i][j] ? Player(i - 1) : positions[j];
+            positions[j] = board.m_moveStates[i].test(j) ? Player(i - 1) : positions[j];
         }
     }
     oss << hex << "  ";
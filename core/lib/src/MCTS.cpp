@@ -2,6 +2,13 @@
 #include "algorithms/MonteCarlo.hpp"
 #include "policies/Random.h"
 #include <iostream>
+#include <fstream>
+#include <cstring>
+#include <mutex>
+#include <atomic>
+#include <unordered_set>
+#include <numeric>
+#include <thread>
 
 using namespace std;
 using namespace std::chrono;
@@ -13,28 +20,175 @@ using Algorithms::Default;
 using Algorithms::Stats;
 using Policies::RandomPolicy;
 
+/* ------------------- NodePool类实现 ------------------- */
+
+// 尺寸类别数，下标为按Alignment取整后的尺寸除以Alignment
+constexpr size_t PoolClasses = NodePool::MaxSize / NodePool::Alignment + 1;
+
+// 空闲结点复用其自身的内存作为链表结点
+struct FreeBlock { 
+    FreeBlock* next; 
+};
+
+struct PoolCache;
+
+// 所有线程共享的部分，仅在持有mutex时访问
+struct PoolShared {
+    std::mutex mutex;
+    std::vector<std::unique_ptr<char[]>> blocks;
+    FreeBlock* freeLists[PoolClasses] = {};
+    std::unordered_set<PoolCache*> caches;
+    ptrdiff_t nodes = 0, bytes = 0; // 已退出线程及无本地缓存时的计数
+};
+
+// 共享部分永不析构，使得静态对象在进程退出阶段释放结点时仍然安全
+static PoolShared& Shared() {
+    static auto shared = new PoolShared;
+    return *shared;
+}
+
+// 从全局空闲链表取出整条链表；若为空，则申请新块并切分。须在持有mutex时调用。
+static FreeBlock* refill(PoolShared& shared, size_t index) {
+    if (auto list = std::exchange(shared.freeLists[index], nullptr)) {
+        return list;
+    }
+    const auto size = index * NodePool::Alignment;
+    auto block = shared.blocks.emplace_back(new char[NodePool::BlockSize]).get();
+    FreeBlock* list = nullptr;
+    for (size_t offset = 0; offset + size <= NodePool::BlockSize; offset += size) {
+        list = new (block + offset) FreeBlock{ list };
+    }
+    return list;
+}
+
+// 线程本地部分。计数只由所属线程写入，原子类型仅为了让Stats可以安全读取。
+static thread_local bool t_cacheDestroyed = false;
+
+struct PoolCache {
+    FreeBlock* freeLists[PoolClasses] = {};
+    std::atomic<ptrdiff_t> nodes{ 0 }, bytes{ 0 };
+
+    PoolCache() {
+        std::lock_guard<std::mutex> lock(Shared().mutex);
+        Shared().caches.insert(this);
+    }
+
+    // 线程退出时，将本地空闲链表与计数归还给全局部分
+    ~PoolCache() {
+        auto& shared = Shared();
+        std::lock_guard<std::mutex> lock(shared.mutex);
+        for (size_t i = 0; i < PoolClasses; ++i) {
+            while (auto block = freeLists[i]) {
+                freeLists[i] = block->next;
+                block->next = std::exchange(shared.freeLists[i], block);
+            }
+        }
+        shared.nodes += nodes, shared.bytes += bytes;
+        shared.caches.erase(this);
+        t_cacheDestroyed = true;
+    }
+
+    void account(ptrdiff_t node_delta, ptrdiff_t byte_delta) {
+        nodes.store(nodes.load(std::memory_order_relaxed) + node_delta, std::memory_order_relaxed);
+        bytes.store(bytes.load(std::memory_order_relaxed) + byte_delta, std::memory_order_relaxed);
+    }
+};
+
+// 线程退出阶段本地缓存已析构时返回nullptr，此时退化为加锁访问全局部分
+static PoolCache* LocalCache() {
+    if (t_cacheDestroyed) {
+        return nullptr;
+    }
+    thread_local PoolCache cache;
+    return &cache;
+}
+
+void* NodePool::Allocate(size_t size) {
+    const auto index = (size + Alignment - 1) / Alignment;
+    auto cache = LocalCache();
+    if (cache == nullptr) {
+        auto& shared = Shared();
+        std::lock_guard<std::mutex> lock(shared.mutex);
+        shared.nodes += 1, shared.bytes += index * Alignment;
+        if (size > MaxSize) {
+            return ::operator new(size);
+        }
+        auto block = refill(shared, index);
+        shared.freeLists[index] = block->next;
+        return block;
+    }
+    cache->account(1, index * Alignment);
+    if (size > MaxSize) {
+        return ::operator new(size);
+    }
+    if (cache->freeLists[index] == nullptr) {
+        std::lock_guard<std::mutex> lock(Shared().mutex);
+        cache->freeLists[index] = refill(Shared(), index);
+    }
+    auto block = cache->freeLists[index];
+    cache->freeLists[index] = block->next;
+    return block;
+}
+
+void NodePool::Deallocate(void* ptr, size_t size) noexcept {
+    const auto index = (size + Alignment - 1) / Alignment;
+    auto cache = LocalCache();
+    if (cache == nullptr) {
+        auto& shared = Shared();
+        std::lock_guard<std::mutex> lock(shared.mutex);
+        shared.nodes -= 1, shared.bytes -= index * Alignment;
+        if (size > MaxSize) {
+            ::operator delete(ptr);
+        } else {
+            shared.freeLists[index] = new (ptr) FreeBlock{ shared.freeLists[index] };
+        }
+        return;
+    }
+    cache->account(-1, -static_cast<ptrdiff_t>(index * Alignment));
+    if (size > MaxSize) {
+        ::operator delete(ptr);
+    } else {
+        cache->freeLists[index] = new (ptr) FreeBlock{ cache->freeLists[index] };
+    }
+}
+
+NodePool::Statistics NodePool::Stats() {
+    auto& shared = Shared();
+    std::lock_guard<std::mutex> lock(shared.mutex);
+    auto nodes = shared.nodes, bytes = shared.bytes;
+    for (auto cache : shared.caches) {
+        nodes += cache->nodes.load(std::memory_order_relaxed);
+        bytes += cache->bytes.load(std::memory_order_relaxed);
+    }
+    return { static_cast<size_t>(nodes), static_cast<size_t>(bytes), shared.blocks.size() * BlockSize };
+}
+
 /* ------------------- Policy类实现 ------------------- */
 
-Policy::Policy(SelectFunc f1, ExpandFunc f2, EvalFunc f3, UpdateFunc f4, double c_puct)
+Policy::Policy(SelectFunc f1, ExpandFunc f2, EvalFunc f3, UpdateFunc f4, double c_puct, BatchEvalFunc f5)
     : select(f1 ? f1 : [this](auto node) { 
         return Default::Select(this, node); 
     }),
-    expand(f2 ? f2 : [this](auto node, auto& board, auto probs) { 
+    expand(f2 ? f2 : f1 || f4 ? ExpandFunc([this](auto node, auto& board, auto probs) { 
         return Default::Expand(this, node, board, std::move(probs)); 
-    }),
+    }) : ExpandFunc([this](auto node, auto& board, auto probs) { // 默认的Select与BackPropogate支持惰性扩展
+        return Default::LazyExpand(this, node, board, std::move(probs)); 
+    })),
     simulate(f3 ? f3 : [this](auto& board) { 
         return Default::Simulate(this, board); 
     }),
     backPropogate(f4 ? f4 : [this](auto node, auto& board, auto value) { 
         return Default::BackPropogate(this, node, board, value); 
     }), 
-    c_puct(c_puct) { 
+    batchSimulate(f5),
+    c_puct(c_puct),
+    c_deterministic(f3 != nullptr) { 
 
 }
 
 // 若未被重写，则创建基类结点
 unique_ptr<Node> Policy::createNode(Node* parent, Position pose, Player player, float value, float prob) {
-    return make_unique<Node>(Node{ parent, pose, player, value, prob });
+    return unique_ptr<Node>(new Node(parent, pose, player, value, prob));
 }
 
 void Policy::prepare(Board& board) {
@@ -57,43 +211,336 @@ bool Policy::checkGameEnd(Board& board) {
     return board.checkGameEnd();
 }
 
+/* ------------------- TranspositionTable类实现 ------------------- */
+
+TranspositionTable::TranspositionTable(size_t bytes) {
+    size_t count = 1;
+    while (2 * count * sizeof(Bucket) <= bytes) {
+        count *= 2;
+    }
+    m_buckets.reset(new Bucket[count]);
+    m_mask = count - 1;
+}
+
+TranspositionTable::Entry& TranspositionTable::claim(Bucket& bucket, uint64_t key) {
+    for (auto& entry : bucket.entries) {
+        if (entry.generation != 0 && entry.key == key) {
+            return entry;
+        }
+    }
+    auto priority = [this](const Entry& entry) -> size_t {
+        if (entry.generation == 0) return 0;
+        if (entry.generation != m_generation) return 1;
+        return 2 + entry.hits + entry.visits;
+    };
+    auto& victim = *std::min_element(std::begin(bucket.entries), std::end(bucket.entries), [&](auto& lhs, auto& rhs) {
+        return priority(lhs) < priority(rhs);
+    });
+    victim.key = key;
+    victim.hits = 0;
+    victim.evaluated = false;
+    victim.visits = 0;
+    victim.value_sum = 0.0f;
+    return victim;
+}
+
+optional<Policy::EvalResult> TranspositionTable::load(uint64_t key) {
+    ++m_probes;
+    auto& bucket = m_buckets[key & m_mask];
+    std::lock_guard<SpinLock> lock(bucket.guard);
+    for (auto& entry : bucket.entries) {
+        if (entry.generation != 0 && entry.key == key && entry.evaluated) {
+            entry.hits += entry.hits < UINT16_MAX;
+            ++m_hits;
+            return Policy::EvalResult{ entry.value, Eigen::Map<const VectorXf>(entry.probs, BOARD_SIZE) };
+        }
+    }
+    return std::nullopt;
+}
+
+void TranspositionTable::store(uint64_t key, const Policy::EvalResult& result) {
+    auto& [value, probs] = result;
+    if (probs.size() != BOARD_SIZE) { // 概率向量不完整的评估结果无法复用
+        return;
+    }
+    auto& bucket = m_buckets[key & m_mask];
+    std::lock_guard<SpinLock> lock(bucket.guard);
+    auto& entry = claim(bucket, key); // 同键的槽保留其共享统计量
+    entry.generation = m_generation;
+    entry.evaluated = true;
+    entry.value = value;
+    std::copy_n(probs.data(), BOARD_SIZE, entry.probs);
+}
+
+float TranspositionTable::accumulate(uint64_t key, float value, size_t visits, float mean) {
+    auto& bucket = m_buckets[key & m_mask];
+    std::lock_guard<SpinLock> lock(bucket.guard);
+    auto& entry = claim(bucket, key);
+    entry.generation = m_generation;
+    if (entry.visits == 0) {
+        entry.visits = static_cast<uint32_t>(visits);
+        entry.value_sum = mean * visits;
+    } else {
+        entry.visits += 1;
+        entry.value_sum += value;
+    }
+    return entry.value_sum / entry.visits;
+}
+
+optional<pair<size_t, float>> TranspositionTable::shared(uint64_t key) {
+    auto& bucket = m_buckets[key & m_mask];
+    std::lock_guard<SpinLock> lock(bucket.guard);
+    for (auto& entry : bucket.entries) {
+        if (entry.generation != 0 && entry.key == key && entry.visits != 0) {
+            return make_pair(size_t(entry.visits), entry.value_sum / entry.visits);
+        }
+    }
+    return std::nullopt;
+}
+
+void TranspositionTable::newSearch() {
+    m_generation = m_generation == UINT16_MAX ? 1 : m_generation + 1; // 0保留给空槽
+}
+
+void TranspositionTable::clear() {
+    for (size_t i = 0; i <= m_mask; ++i) {
+        for (auto& entry : m_buckets[i].entries) {
+            entry.generation = 0;
+        }
+    }
+    m_generation = 1;
+    m_probes = m_hits = 0;
+}
+
+/* ------------------- TimeManager类实现 ------------------- */
+
+void TimeManager::start(milliseconds limit, size_t moves, const Node* root, Clock::time_point begin) {
+    m_start = begin;
+    m_startVisits = root->node_visits;
+    m_calls = 0;
+    m_stopped = false;
+    if (m_reportedVisits) {
+        for (size_t i = 0; i < BOARD_SIZE; ++i) {
+            m_reportedVisits[i] = 0;
+        }
+        m_reportedDone = 0;
+    }
+    if (c_gameBudget > 0ms) {
+        // 粗略估计一局约下满棋盘的四分之一，由双方平分
+        size_t moves_left = std::max(c_minMovesLeft, moves < BOARD_SIZE / 4 ? (BOARD_SIZE / 4 - moves) / 2 : size_t(0));
+        m_limit = std::min(limit, m_remaining);
+        m_target = std::min(m_remaining / static_cast<milliseconds::rep>(moves_left), m_limit);
+    } else {
+        m_limit = m_target = limit;
+    }
+}
+
+// 首次调用不检查，保证每回合至少完成一次迭代，根结点得以扩展。
+// 用时上限每次都检查；读取根结点统计量的提前终止与延长思考判断每c_checkInterval次才进行一次。
+bool TimeManager::shouldStop(const Node* root) {
+    if (m_stopped.load(std::memory_order_relaxed)) {
+        return true;
+    }
+    auto calls = m_calls.fetch_add(1, std::memory_order_relaxed);
+    if (calls == 0) {
+        return false;
+    }
+    using Millis = duration<double, std::milli>;
+    const double elapsed = Millis(Clock::now() - m_start).count();
+    const double extended = std::min(m_target.count() * c_extension, double(m_limit.count()));
+    if (elapsed >= extended) {
+        return m_stopped = true;
+    }
+    if (calls % c_checkInterval != 0) {
+        return false;
+    }
+    size_t first = 0, second = 0, done; // 根结点子结点中最多与第二多的访问次数，以及本回合的迭代次数
+    auto rank = [&](size_t visits) {
+        if (visits > first) {
+            second = first, first = visits;
+        } else if (visits > second) {
+            second = visits;
+        }
+    };
+    if (m_reportedVisits) {
+        for (size_t i = 0; i < BOARD_SIZE; ++i) {
+            rank(m_reportedVisits[i].load(std::memory_order_relaxed));
+        }
+        done = m_reportedDone.load(std::memory_order_relaxed);
+    } else {
+        std::lock_guard<SpinLock> lock(root->guard);
+        for (auto&& child : root->children) {
+            rank(child ? static_cast<size_t>(child->node_visits) : 0);
+        }
+        done = root->node_visits - m_startVisits;
+    }
+    const bool close = first > 0 && second >= c_closeRatio * first;
+    bool stop = elapsed >= (close ? extended : m_target.count());
+    if (!stop && done > 0 && elapsed > 0) {
+        stop = first - second > done / elapsed * (extended - elapsed); // 即使延长思考也无法被追上
+    }
+    if (stop) {
+        m_stopped = true;
+    }
+    return stop;
+}
+
+void TimeManager::enableReports() {
+    m_reportedVisits.reset(new std::atomic<size_t>[BOARD_SIZE]());
+}
+
+void TimeManager::beginReport(const Node* root, Report& report) const {
+    report.visits.assign(BOARD_SIZE, 0);
+    report.root_visits = root->node_visits;
+    report.calls = 0;
+}
+
+// 按位置汇总，因而与子结点在各树中的排列顺序（如RAVE的调整）无关
+void TimeManager::report(const Node* root, Report& report) {
+    if (++report.calls < c_checkInterval) {
+        return;
+    }
+    report.calls = 0;
+    for (auto&& child : root->children) {
+        if (child) {
+            const size_t visits = child->node_visits;
+            m_reportedVisits[child->position] += visits - report.visits[child->position];
+            report.visits[child->position] = visits;
+        }
+    }
+    const size_t visits = root->node_visits;
+    m_reportedDone += visits - report.root_visits;
+    report.root_visits = visits;
+}
+
+void TimeManager::finish() {
+    m_elapsed = duration_cast<milliseconds>(Clock::now() - m_start);
+    if (c_gameBudget > 0ms) {
+        m_remaining = std::max(m_remaining - m_elapsed, 0ms);
+    }
+}
+
+void TimeManager::setBudget(milliseconds budget) {
+    c_gameBudget = m_remaining = budget;
+}
+
+/* ------------------- SearchStats类实现 ------------------- */
+
+SearchStats& SearchStats::operator+=(const SearchStats& other) {
+    playouts += other.playouts;
+    depth_sum += other.depth_sum;
+    max_depth = std::max(max_depth, other.max_depth);
+    nodes_created += other.nodes_created;
+    pruned += other.pruned;
+    reused_nodes += other.reused_nodes;
+    reused_visits += other.reused_visits;
+    root_visits += other.root_visits;
+    evaluations += other.evaluations;
+    sampled += other.sampled;
+    for (int i = 0; i < PhaseCount; ++i) {
+        phase_time[i] += other.phase_time[i];
+    }
+    return *this;
+}
+
 /* ------------------- MCTS类实现 ------------------- */
 
-// 更新后，原根节点由unique_ptr自动释放，其余的非子树结点也会被链式自动销毁。
-inline Node* updateRoot(MCTS& mcts, unique_ptr<Node>&& next_node) {
-    mcts.m_root = std::move(next_node);
-    mcts.m_root->parent = nullptr;
-    return mcts.m_root.get();
+// 统计以node为根的子树的结点数。已被移走的子结点（空指针）不计入。
+inline size_t countNodes(const Node* node) {
+    size_t count = 1;
+    for (auto&& child : node->children) {
+        if (child) { 
+            count += countNodes(child.get()); 
+        }
+    }
+    return count;
+}
+
+// next_node按值传入，调用时即已从原根节点中移出，因此原根节点所剩的结点恰为将被丢弃的部分，交由后台释放。
+// 保留的子树通常远小于被丢弃的部分，故按保留部分重新计数，调用线程无需遍历被丢弃的结点。
+Node* MCTS::updateRoot(unique_ptr<Node> next_node) {
+    release(std::exchange(m_root, std::move(next_node)));
+    m_root->parent = nullptr;
+    m_size = countNodes(m_root.get());
+    return m_root.get();
+}
+
+// 每次释放都使用一个新线程：NodePool的线程本地空闲链表只在线程退出时归还全局，常驻的释放线程会把回收的结点据为己有。
+// 每回合换根两次（己方与对方各一手），第一次丢弃的几乎是整棵旧树，因此不能等待上一次释放，只回收已经结束的线程。
+void MCTS::release(unique_ptr<Node> node) {
+    m_reclaimers.remove_if([](Reclaimer& reclaimer) {
+        if (!reclaimer.done.load(std::memory_order_acquire)) {
+            return false;
+        }
+        reclaimer.thread.join(); // 线程已结束，join不会阻塞
+        return true;
+    });
+    auto& reclaimer = m_reclaimers.emplace_back();
+    reclaimer.thread = std::thread([node = std::move(node), &done = reclaimer.done]() mutable {
+        node.reset();
+        done.store(true, std::memory_order_release);
+    });
+}
+
+void MCTS::waitForRelease() {
+    for (auto& reclaimer : m_reclaimers) {
+        reclaimer.thread.join();
+    }
+    m_reclaimers.clear();
+}
+
+MCTS::~MCTS() {
+    waitForRelease();
 }
 
 MCTS::MCTS(
     milliseconds c_duration,
     Position last_move,
     Player last_player,
-    shared_ptr<Policy> policy
+    shared_ptr<Policy> policy,
+    size_t c_threads,
+    Parallelism c_parallelism,
+    size_t c_batch,
+    size_t c_table_size,
+    size_t c_node_budget
 ) :
     m_policy(policy ? policy : shared_ptr<Policy>(new RandomPolicy)),
     m_root(m_policy->createNode(nullptr, last_move, last_player, 0.0, 1.0)),
     m_size(1),
     m_iterations(0),
     m_duration(c_duration),
+    c_threads(std::max<size_t>(c_threads, 1)),
+    c_parallelism(c_parallelism),
+    c_batch(std::max<size_t>(c_batch, 1)),
+    c_nodeBudget(c_node_budget),
+    m_table(c_table_size ? make_unique<TranspositionTable>(c_table_size) : nullptr),
     c_constraint(Constraint::Duration) { 
-    
+    createEnsemble();
 }
 
 MCTS::MCTS(
     size_t   c_iterations,
     Position last_move,
     Player   last_player,
-    shared_ptr<Policy> policy
+    shared_ptr<Policy> policy,
+    size_t c_threads,
+    Parallelism c_parallelism,
+    size_t c_batch,
+    size_t c_table_size,
+    size_t c_node_budget
 ) :
     m_policy(policy ? policy : shared_ptr<Policy>(new RandomPolicy)),
     m_root(m_policy->createNode(nullptr, last_move, last_player, 0.0, 1.0)),
     m_size(1),
     m_iterations(c_iterations),
     m_duration(0ms),
+    c_threads(std::max<size_t>(c_threads, 1)),
+    c_parallelism(c_parallelism),
+    c_batch(std::max<size_t>(c_batch, 1)),
+    c_nodeBudget(c_node_budget),
+    m_table(c_table_size ? make_unique<TranspositionTable>(c_table_size) : nullptr),
     c_constraint(Constraint::Iterations) {
-
+    createEnsemble();
 };
 
 Position MCTS::getAction(Board& board) {
@@ -106,9 +553,16 @@ Policy::EvalResult MCTS::evalState(Board& board) {
     Eigen::VectorXf child_visits;
     child_visits.setZero((int)BOARD_SIZE);
     for (auto&& node : m_root->children) {
-        child_visits[node->position] = node->node_visits;
+        if (node && node->proof == Node::Proof::Win) { // 已证明必胜时只保留该着法
+            child_visits.setZero();
+            child_visits[node->position] = 1;
+            break;
+        }
+        if (node) { // 未创建的子结点访问次数为0
+            child_visits[node->position] = node->node_visits;
+        }
     }
-    cout << Eigen::Map<const Eigen::Array<float, 15, 15, Eigen::RowMajor>>(child_visits.data()) << endl;
+    cout << Eigen::Map<const Eigen::Array<float, HEIGHT, WIDTH, Eigen::RowMajor>>(child_visits.data()) << endl;
 	child_visits = child_visits.normalized().unaryExpr([](float v) { return v ? v + 1 : v; });
     auto action_probs = Stats::TempBasedProbs(
         child_visits, board.m_moveRecord.size() < 15 ? 1 : 1e-2 
@@ -126,24 +580,46 @@ void MCTS::syncWithBoard(Board & board) {
 
 // AlphaZero的论文中，对MCTS的再利用策略
 // 参见https://stackoverflow.com/questions/47389700
+// 未创建的子结点视作访问次数为0；若均未创建，则与此前一样取第一个子结点。
+// 已证明必胜的子结点优先于其余子结点，已证明必败的子结点排在最后，同类之间再比较访问次数。
 Node* MCTS::stepForward() {
-    auto iter = max_element(m_root->children.begin(), m_root->children.end(), [](auto&& lhs, auto&& rhs) {
-        return lhs->node_visits < rhs->node_visits;
+    if (m_root->children.empty()) {
+        return m_root.get();
+    }
+    auto rank = [](const unique_ptr<Node>& node) {
+        const auto proof = node ? node->proof : Node::Proof::None;
+        return make_pair(proof == Node::Proof::Win ? 2 : proof == Node::Proof::Loss ? 0 : 1, node ? size_t(node->node_visits) : 0);
+    };
+    auto iter = max_element(m_root->children.begin(), m_root->children.end(), [&](auto&& lhs, auto&& rhs) {
+        return rank(lhs) < rank(rhs);
     });
-    return iter != m_root->children.end() ? updateRoot(*this, std::move(*iter)) : m_root.get();
+    materialize(iter - m_root->children.begin());
+    return m_ensemble.empty() ? updateRoot(std::move(*iter)) : stepForward((*iter)->position);
 }
 
 Node* MCTS::stepForward(Position next_move) {
-    auto iter = find_if(m_root->children.begin(), m_root->children.end(), [next_move](auto&& node) {
-        return node->position == next_move;
-    });
+    auto iter = m_root->children.begin();
+    for (; iter != m_root->children.end(); ++iter) {
+        if (*iter ? (*iter)->position == next_move : m_root->childPosition(iter - m_root->children.begin()) == next_move) {
+            materialize(iter - m_root->children.begin());
+            break;
+        }
+    }
     if (iter == m_root->children.end()) { // 这个迷之hack是为了防止Python模块中出现引用Bug...
         iter = m_root->children.emplace(
             m_root->children.end(), 
             m_policy->createNode(nullptr, next_move, -m_root->player, 0.0f, 1.0f)
         );
+        m_size += 1;
+    }
+    updateRoot(std::move(*iter));
+    if (!m_ensemble.empty()) { // 根并行时，各棵树随之各自复用其子树
+        for (auto& tree : m_ensemble) {
+            tree->stepForward(next_move);
+            m_size += tree->m_size;
+        }
     }
-    return updateRoot(*this, std::move(*iter));
+    return m_root.get();
 }
 
 void MCTS::reset() {
@@ -151,50 +627,639 @@ void MCTS::reset() {
         m_root->children.end(), 
         m_policy->createNode(nullptr, Position(-1), Player::White, 0.0f, 1.0f)
     );
-    m_root = std::move(*iter);
+    release(std::exchange(m_root, std::move(*iter)));
     m_size = 1;
+    if (m_table) {
+        m_table->clear();
+    }
+    m_timer.reset();
+    for (auto& tree : m_ensemble) {
+        tree->reset();
+        m_size += tree->m_size;
+    }
+}
+
+// 收集非根的已扩展结点的<访问次数, 已创建的子结点数>
+static void collectExpanded(const Node* node, vector<pair<size_t, size_t>>& expanded) {
+    for (auto&& child : node->children) {
+        if (child && !child->isLeaf()) {
+            auto created = std::count_if(child->children.begin(), child->children.end(), [](auto&& c) { return c != nullptr; });
+            expanded.emplace_back(child->node_visits, created);
+            collectExpanded(child.get(), expanded);
+        }
+    }
+}
+
+// 将访问次数不超过threshold的非根结点收为叶结点，返回移除的结点数
+static size_t collapseCold(Node* node, size_t threshold) {
+    size_t removed = 0;
+    for (auto&& child : node->children) {
+        if (!child || child->isLeaf()) {
+            continue;
+        } else if (child->node_visits <= threshold) {
+            removed += countNodes(child.get()) - 1;
+            child->children.clear();
+            child->child_stats.reset();
+        } else {
+            removed += collapseCold(child.get(), threshold);
+        }
+    }
+    return removed;
+}
+
+// 父结点访问次数不超过阈值的结点都将被移除，故按访问次数从小到大累加各结点的子结点数，即可求出满足目标的最小阈值。
+void MCTS::prune() {
+    const size_t target = c_nodeBudget * 3 / 4;
+    if (c_nodeBudget == 0 || m_size <= target) {
+        return;
+    }
+    vector<pair<size_t, size_t>> expanded;
+    collectExpanded(m_root.get(), expanded);
+    std::sort(expanded.begin(), expanded.end());
+    size_t freed = 0, threshold = 0;
+    for (auto [visits, count] : expanded) {
+        if (m_size - freed <= target) {
+            break;
+        }
+        freed += count;
+        threshold = visits;
+    }
+    if (freed > 0) {
+        auto removed = collapseCold(m_root.get(), threshold);
+        m_size -= removed;
+        m_stats.pruned += removed;
+    }
+}
+
+// 不施加根结点噪声，搜索结果与正常回合的搜索无异，换根后可被直接复用。
+size_t MCTS::ponder(Board& board, const std::atomic<bool>& stop) {
+    syncWithBoard(board);
+    if (!m_ensemble.empty()) { // 每棵树由一个线程以各自的棋盘拷贝思考，主线程负责第一棵树
+        vector<Board> boards(m_ensemble.size() - 1, board);
+        vector<size_t> iterations(m_ensemble.size());
+        vector<thread> threads;
+        for (auto& tree : m_ensemble) {
+            tree->c_ponderBudget = c_ponderBudget / m_ensemble.size();
+        }
+        for (size_t i = 1; i < m_ensemble.size(); ++i) {
+            threads.emplace_back([&, i]() { iterations[i] = m_ensemble[i]->ponder(boards[i - 1], stop); });
+        }
+        iterations[0] = m_ensemble[0]->ponder(board, stop);
+        for (auto& thread : threads) {
+            thread.join();
+        }
+        m_size = countNodes(m_root.get());
+        for (auto& tree : m_ensemble) {
+            m_size += tree->m_size;
+        }
+        return std::accumulate(iterations.begin(), iterations.end(), size_t(0));
+    }
+    m_policy->prepare(board);
+    std::atomic<size_t> iterations = 0;
+    if (c_threads > 1 && m_policy->isConcurrent() && !c_seed) { // 与runConcurrentPlayouts相同，只是以stop与结点数上限结束
+        std::atomic<size_t> size = 0;
+        auto worker = [&](Board& local) {
+            SearchStats stats; // 后台思考的统计量不计入下一回合
+            while (!stop.load(std::memory_order_relaxed) && underPonderBudget(m_size + size)) {
+                size += concurrentPlayout(local, underBudget(m_size + size), stats);
+                ++iterations;
+            }
+        };
+        vector<Board> boards(c_threads - 1, board);
+        vector<thread> threads;
+        for (auto& local : boards) {
+            threads.emplace_back(worker, std::ref(local));
+        }
+        worker(board);
+        for (auto& thread : threads) {
+            thread.join();
+        }
+        m_size += size;
+        prune();
+    } else {
+        for (; !stop.load(std::memory_order_relaxed) && !solved() && underPonderBudget(m_size); ++iterations) {
+            m_size += playout(board);
+            if (!underBudget(m_size)) {
+                prune();
+            }
+        }
+    }
+    m_policy->cleanup(board);
+    return iterations;
+}
+
+/*
+    树文件的格式（按本机字节序）：TreeHeader，根结点局面的着法记录，随后按先序存放各结点。
+    每个结点为一条TreeRecord；若其已扩展，紧随其后的是长为4n的child_stats镜像与n个字节的"已创建"标记，
+    再依次是各个已创建子结点的记录。结点的玩家总与父结点相反，因此只有根结点的玩家记录在头部。
+*/
+struct TreeHeader {
+    uint32_t magic = 0x54534D47; // "GMST"
+    uint16_t version = 1;
+    uint16_t board_size = BOARD_SIZE;
+    int32_t  player = 0;         // 根结点的玩家
+    uint32_t moves = 0;          // 根结点局面的着法数
+};
+
+struct TreeRecord {
+    float    state_value;
+    float    action_prob;
+    uint32_t node_visits;
+    int16_t  position;
+    uint16_t children;
+};
+
+static void writeNode(ostream& os, const Node* node) {
+    const auto n = node->children.size();
+    TreeRecord record{ node->state_value, node->action_prob, static_cast<uint32_t>(node->node_visits), node->position.id, static_cast<uint16_t>(n) };
+    os.write(reinterpret_cast<const char*>(&record), sizeof(record));
+    if (n == 0) {
+        return;
+    }
+    vector<char> created(n);
+    for (size_t i = 0; i < n; ++i) {
+        created[i] = node->children[i] != nullptr;
+    }
+    os.write(reinterpret_cast<const char*>(node->child_stats.get()), 4 * n * sizeof(float));
+    os.write(created.data(), n);
+    for (auto&& child : node->children) {
+        if (child) {
+            writeNode(os, child.get());
+        }
+    }
+}
+
+// 在整块读入的文件内容上顺序解析，任何越界都视为文件损坏
+struct TreeReader {
+    const char* cur;
+    const char* end;
+
+    template <typename T>
+    bool read(T* out, size_t count = 1) {
+        const size_t bytes = count * sizeof(T);
+        if (static_cast<size_t>(end - cur) < bytes) {
+            return false;
+        }
+        std::memcpy(out, cur, bytes);
+        cur += bytes;
+        return true;
+    }
+};
+
+// 解析以node为根的子树（node的记录已读出），返回是否成功。结点经由Policy::createNode创建，count累计创建的结点数。
+static bool readChildren(TreeReader& reader, Policy& policy, Node* node, size_t n, size_t& count) {
+    if (n == 0) {
+        return true;
+    } else if (n > BOARD_SIZE) {
+        return false;
+    }
+    node->children.resize(n);
+    node->child_stats.reset(new float[4 * n]);
+    vector<char> created(n);
+    if (!reader.read(node->child_stats.get(), 4 * n) || !reader.read(created.data(), n)) {
+        return false;
+    }
+    for (size_t i = 0; i < n; ++i) {
+        if (auto pose = node->child_stats[3 * n + i]; !(pose >= 0 && pose < BOARD_SIZE)) {
+            return false;
+        }
+    }
+    for (size_t i = 0; i < n; ++i) {
+        if (!created[i]) {
+            continue;
+        }
+        TreeRecord record;
+        if (!reader.read(&record) || record.position != node->childPosition(i)) {
+            return false;
+        }
+        auto& child = node->children[i] = policy.createNode(node, record.position, -node->player, record.state_value, record.action_prob);
+        child->index = static_cast<std::uint16_t>(i);
+        child->node_visits = record.node_visits;
+        child->syncStats();
+        count += 1;
+        if (!readChildren(reader, policy, child.get(), record.children, count)) {
+            return false;
+        }
+    }
+    return true;
+}
+
+bool MCTS::save(const std::string& path, const Board& board) const {
+    if (!m_ensemble.empty() || m_root->position != (board.m_moveRecord.empty() ? Position(-1) : board.m_moveRecord.back())) {
+        return false;
+    }
+    ofstream ofs(path, ios::binary | ios::trunc);
+    if (!ofs.is_open()) {
+        return false;
+    }
+    TreeHeader header;
+    header.player = static_cast<int32_t>(m_root->player);
+    header.moves = static_cast<uint32_t>(board.m_moveRecord.size());
+    ofs.write(reinterpret_cast<const char*>(&header), sizeof(header));
+    ofs.write(reinterpret_cast<const char*>(board.m_moveRecord.data()), header.moves * sizeof(Position));
+    writeNode(ofs, m_root.get());
+    return ofs.good();
+}
+
+// 文件整块读入后再解析：相比逐条读取流，系统调用次数与文件大小无关。
+bool MCTS::load(const std::string& path, Board& board) {
+    if (!m_ensemble.empty()) {
+        return false;
+    }
+    ifstream ifs(path, ios::binary | ios::ate);
+    if (!ifs.is_open()) {
+        return false;
+    }
+    vector<char> buffer(static_cast<size_t>(ifs.tellg()));
+    ifs.seekg(0);
+    if (!ifs.read(buffer.data(), buffer.size())) {
+        return false;
+    }
+
+    TreeReader reader{ buffer.data(), buffer.data() + buffer.size() };
+    TreeHeader header, expected;
+    if (!reader.read(&header) || header.magic != expected.magic || header.version != expected.version
+        || header.board_size != expected.board_size || header.moves > board.m_moveRecord.size()) {
+        return false;
+    }
+    vector<Position> moves(header.moves);
+    TreeRecord record;
+    if (!reader.read(moves.data(), moves.size()) || !reader.read(&record)
+        || !std::equal(moves.begin(), moves.end(), board.m_moveRecord.begin())
+        || record.position != (moves.empty() ? Position(-1) : moves.back())) {
+        return false;
+    }
+    auto root = m_policy->createNode(nullptr, record.position, static_cast<Player>(header.player), record.state_value, record.action_prob);
+    root->node_visits = record.node_visits;
+    size_t count = 1;
+    if (!readChildren(reader, *m_policy, root.get(), record.children, count)) {
+        return false;
+    }
+
+    release(std::exchange(m_root, std::move(root)));
+    m_size = count;
+    syncWithBoard(board);
+    if (!underBudget(m_size)) {
+        prune();
+    }
+    return true;
+}
+
+void MCTS::materialize(size_t index) {
+    Default::Materialize(m_policy.get(), m_root.get(), index);
+    m_size += m_policy->m_materialized.exchange(0, std::memory_order_relaxed);
 }
 
 size_t MCTS::playout(Board& board) {
+    if (m_policy->playoutKernel) {
+        return m_policy->playoutKernel(*this, board);
+    }
+    PhaseTimer timer(m_stats, m_stats.playouts % C_SAMPLE_INTERVAL == 0);
     Node* node = m_root.get();      // 裸指针用作观察指针，不对树结点拥有所有权
-    while (!node->isLeaf()) {   // 检测当前结点是否所有可行手都被拓展过
+    auto key = board.m_hash;        // 叶结点局面的键值，沿路径由根结点的键值推得（带缓存的策略不在外部棋盘上落子）
+    while (!node->isLeaf() && node->proof == Node::Proof::None) {   // 检测当前结点是否所有可行手都被拓展过，已证明的结点无需再向下搜索
         node = m_policy->select(node);  // 若当前结点已拓展完毕，则根据价值公式选出下一个探索结点
         m_policy->applyMove(board, node->position);
+        key ^= Board::ZobristKey(node->player, node->position) ^ Board::ZobristKey(Player::None);
     }
+    m_stats.record(board.m_moveRecord.size() - m_policy->m_initActs);
+    timer.lap(SearchStats::Select);
     double node_value;
     size_t expand_size;
-    if (!m_policy->checkGameEnd(board)) {  // 检查终结点游戏是否结束
-        auto [state_value, action_probs] = m_policy->simulate(board); // 获取当前盘面相对于「当前应下玩家」的价值与概率分布
+    if (node->proof != Node::Proof::None) { // 已证明的结点直接以其固定的价值反向传播
+        expand_size = 0;
+        node_value = node->state_value;
+    } else if (!m_policy->checkGameEnd(board)) {  // 检查终结点游戏是否结束
+        auto [state_value, action_probs] = evaluate(board, m_policy->simulate, m_stats); // 获取当前盘面相对于「当前应下玩家」的价值与概率分布
+        timer.lap(SearchStats::Simulate);
         expand_size = m_policy->expand(node, board, std::move(action_probs)); // 根据传入的概率向量扩展一层结点
+        timer.lap(SearchStats::Expand);
         node_value = -state_value; // 由于node保存的是「下出变成当前局面的一手」的玩家，因此其价值应取相反数
     } else {
         expand_size = 0;
         node_value = CalcScore(node->player, board.m_winner); // 根据绝对价值(winner)获取当前局面于玩家的相对价值
+        prove(node, board.m_winner); // 终局即已证明，并向上传播
     }
     m_policy->backPropogate(node, board, node_value);     
+    if (m_table) {
+        shareStats(node, key, node_value);
+    }
     m_policy->revertMove(board, board.m_moveRecord.size() - m_policy->m_initActs); // 重置回初始局面
-    return expand_size;
+    timer.lap(SearchStats::BackPropogate);
+    return expand_size + m_policy->m_materialized.exchange(0, std::memory_order_relaxed); // 计入Select中新建的结点
+}
+
+void MCTS::prove(Node* node, Player winner) {
+    Default::Prove(node, winner, m_policy->m_initActs);
+}
+
+// 根结点不参与共享；已证明的结点价值固定，只需继续推算父结点的键值
+void MCTS::shareStats(Node* node, uint64_t key, float value) {
+    for (; node->parent != nullptr; node = node->parent, value = -value) {
+        if (node->proof == Node::Proof::None) {
+            node->state_value = m_table->accumulate(key, value, node->node_visits, node->state_value);
+            node->syncStats();
+        }
+        key ^= Board::ZobristKey(node->player, node->position) ^ Board::ZobristKey(Player::None);
+    }
+}
+
+// 与playout流程相同，区别在于：
+// ① 访问结点的子结点与统计量前先获取结点锁，且同一时刻至多持有一把锁。
+// ② Select选出的结点立即施加虚拟损失，使其他线程倾向于探索别的分支。
+// ③ Simulate不持有锁；其后若结点已被其他线程扩展，则不再重复扩展。
+// ④ 与StaticPlayout一致，在已证明的结点处停止向下搜索。
+Node* MCTS::concurrentSelect(Board& board) {
+    Node* node = m_root.get();
+    while (true) {
+        node->guard.lock();
+        if (node->isLeaf() || node->proof != Node::Proof::None) {
+            node->guard.unlock();
+            return node;
+        }
+        auto child = m_policy->select(node);
+        Default::VirtualLoss(child);
+        node->guard.unlock();
+        m_policy->applyMove(board, child->position);
+        node = child;
+    }
+}
+
+size_t MCTS::concurrentPlayout(Board& board, bool expandable, SearchStats& stats) {
+    Node* node = concurrentSelect(board);
+    stats.record(board.m_moveRecord.size() - m_policy->m_initActs);
+    double node_value;
+    size_t expand_size = 0;
+    if (node->proof != Node::Proof::None) { // 已证明的结点直接以其固定的价值反向传播
+        node_value = node->state_value;
+    } else if (!m_policy->checkGameEnd(board)) {
+        auto [state_value, action_probs] = evaluate(board, m_policy->simulate, stats);
+        if (expandable) {
+            std::lock_guard<SpinLock> lock(node->guard);
+            if (node->isLeaf()) {
+                expand_size = m_policy->expand(node, board, std::move(action_probs));
+            }
+        }
+        node_value = -state_value;
+    } else {
+        node_value = CalcScore(node->player, board.m_winner);
+    }
+    Default::ConcurrentBackPropogate(node, node_value);
+    m_policy->revertMove(board, board.m_moveRecord.size() - m_policy->m_initActs);
+    return expand_size + m_policy->m_materialized.exchange(0, std::memory_order_relaxed);
 }
 
 void MCTS::runPlayouts(Board& board) {
-    auto start = system_clock::now();
+    auto start = steady_clock::now();
     this->syncWithBoard(board);
-	Default::AddNoise(m_root.get());
-    m_policy->prepare(board);    
+    prune(); // 换根后的子树可能仍超出预算
+    m_stats = SearchStats();
+    m_stats.reused_nodes = m_size;
+    m_stats.reused_visits = m_root->node_visits;
+    if (c_seed) {
+        RandomEngine::Seed(*c_seed ^ board.m_hash);
+    }
+    if (c_constraint == Constraint::Duration) {
+        if (m_sharedTimer) { // 根并行的成员：由汇总树的时间管理器计时
+            m_sharedTimer->beginReport(m_root.get(), m_report);
+        } else {
+            m_timer.start(m_duration, board.m_moveRecord.size(), m_root.get(), start); // 换根与剪枝的用时同样计入
+        }
+    }
+    if (m_table) {
+        m_table->newSearch();
+    }
+    if (!m_ensemble.empty()) {
+        runEnsemblePlayouts(board);
+    } else if (c_batch > 1 && m_policy->batchSimulate) {
+        runBatchedPlayouts(board);
+    } else {
+        Default::AddNoise(m_root.get());
+        m_policy->prepare(board);
+        if (c_threads > 1 && m_policy->isConcurrent() && !c_seed) {
+            runConcurrentPlayouts(board);
+        } else if (c_constraint == Constraint::Duration) {
+            for (m_iterations = 0; !solved() && !timeUp(); ++m_iterations) {
+                m_size += playout(board);
+                if (!underBudget(m_size)) {
+                    prune();
+                }
+            }
+        } else {
+            for (size_t i = 0; i < m_iterations && !solved(); ++i) {
+                m_size += playout(board);
+                if (!underBudget(m_size)) {
+                    prune();
+                }
+            }
+        }
+        m_policy->cleanup(board);
+    }
+    prune(); // 树并行与批量评估时只在搜索结束后剪枝
+    if (c_constraint == Constraint::Duration) {
+        if (!m_sharedTimer) {
+            m_timer.finish();
+        }
+    } else {
+        m_duration = duration_cast<milliseconds>(steady_clock::now() - start);
+    }
+    if (!m_ensemble.empty()) { // 汇总树本身不搜索，统计量取各棵树之和
+        m_stats = SearchStats();
+        for (auto& tree : m_ensemble) {
+            m_stats += tree->m_stats;
+        }
+    } else {
+        m_stats.root_visits = m_root->node_visits;
+        m_stats.nodes_created = m_size + m_stats.pruned - m_stats.reused_nodes;
+    }
+    m_stats.duration = duration_cast<milliseconds>(steady_clock::now() - start);
+}
+
+// 主线程与c_threads-1个工作线程共享同一棵树，每个工作线程持有一份棋盘的拷贝。
+void MCTS::runConcurrentPlayouts(Board& board) {
+    std::atomic<size_t> iterations = 0, size = 0;
+    auto worker = [&](Board& local, SearchStats& stats) {
+        if (c_constraint == Constraint::Duration) {
+            for (; !timeUp(); ++iterations) {
+                size += concurrentPlayout(local, underBudget(m_size + size), stats);
+            }
+        } else {
+            while (iterations++ < m_iterations) {
+                size += concurrentPlayout(local, underBudget(m_size + size), stats);
+            }
+        }
+    };
+    vector<Board> boards(c_threads - 1, board);
+    vector<SearchStats> stats(c_threads - 1);
+    vector<thread> threads;
+    for (size_t i = 0; i < boards.size(); ++i) {
+        threads.emplace_back(worker, std::ref(boards[i]), std::ref(stats[i]));
+    }
+    worker(board, m_stats);
+    for (auto& thread : threads) {
+        thread.join();
+    }
+    for (auto& local : stats) {
+        m_stats += local;
+    }
+    if (c_constraint == Constraint::Duration) {
+        m_iterations = iterations;
+    }
+    m_size += size;
+}
+
+// 树并行时可被多个线程同时调用；根并行的成员只在自己的搜索线程中调用。
+bool MCTS::timeUp() {
+    if (m_sharedTimer == nullptr) {
+        return m_timer.shouldStop(m_root.get());
+    }
+    m_sharedTimer->report(m_root.get(), m_report);
+    return m_sharedTimer->shouldStop(m_root.get());
+}
+
+void MCTS::createEnsemble() {
+    if (c_threads <= 1 || c_parallelism != Parallelism::Root || m_policy->clone() == nullptr) {
+        return;
+    }
+    const size_t table_size = m_table ? m_table->memory() : 0;
+    for (size_t i = 0; i < c_threads; ++i) {
+        auto tree = c_constraint == Constraint::Duration
+            ? make_unique<MCTS>(m_duration, m_root->position, m_root->player, m_policy->clone(), 1, Parallelism::Tree, c_batch, table_size, c_nodeBudget / c_threads)
+            : make_unique<MCTS>(m_iterations, m_root->position, m_root->player, m_policy->clone(), 1, Parallelism::Tree, c_batch, table_size, c_nodeBudget / c_threads);
+        m_size += tree->m_size;
+        tree->m_sharedTimer = &m_timer;
+        m_ensemble.push_back(std::move(tree));
+    }
+    m_timer.enableReports();
+    m_table.reset(); // 汇总树本身不搜索，无需置换表
+}
+
+// 每棵树由一个线程以各自的棋盘拷贝搜索，主线程负责第一棵树。
+// 按时间控制时各棵树共用本树的时间管理器，由其基于汇总的统计量决定提前终止或延长思考。
+void MCTS::runEnsemblePlayouts(Board& board) {
+    for (size_t i = 0; i < m_ensemble.size(); ++i) {
+        m_ensemble[i]->c_seed = c_seed ? std::optional<uint64_t>(*c_seed + i) : std::nullopt;
+    }
+    vector<Board> boards(m_ensemble.size() - 1, board);
+    vector<thread> threads;
+    for (size_t i = 1; i < m_ensemble.size(); ++i) {
+        threads.emplace_back([this, i, &boards]() { m_ensemble[i]->runPlayouts(boards[i - 1]); });
+    }
+    m_ensemble[0]->runPlayouts(board);
+    for (auto& thread : threads) {
+        thread.join();
+    }
+    mergeEnsemble();
     if (c_constraint == Constraint::Duration) {
         m_iterations = 0;
-        for (auto end = start; end - start < m_duration; 
-            end = system_clock::now(), ++m_iterations) {
-            m_size += playout(board);
+        for (auto& tree : m_ensemble) {
+            m_iterations += tree->m_iterations;
         }
-    } else if (c_constraint == Constraint::Iterations) {
-        m_duration = 0ms;
-        for (auto i = 0; i < m_iterations; ++i) {
-            m_size += playout(board);
+    }
+}
+
+// 访问次数直接相加，价值按访问次数加权平均，先验概率取平均。
+void MCTS::mergeEnsemble() {
+    Eigen::VectorXd visits = Eigen::VectorXd::Zero(BOARD_SIZE), values = Eigen::VectorXd::Zero(BOARD_SIZE), priors = Eigen::VectorXd::Zero(BOARD_SIZE);
+    Eigen::Array<bool, -1, 1> expanded = Eigen::Array<bool, -1, 1>::Zero(BOARD_SIZE);
+    size_t root_visits = 0;
+    double root_value = 0.0;
+    for (auto& tree : m_ensemble) {
+        const auto root = tree->m_root.get();
+        for (size_t i = 0; i < root->children.size(); ++i) {
+            const auto position = root->childPosition(i);
+            if (auto& child = root->children[i]) {
+                visits[position] += child->node_visits;
+                values[position] += child->node_visits * child->state_value;
+            }
+            priors[position] += root->childPriors()[i] / m_ensemble.size();
+            expanded[position] = true;
         }
-        m_duration = duration_cast<milliseconds>(system_clock::now() - start);
+        root_visits += tree->m_root->node_visits;
+        root_value += tree->m_root->node_visits * tree->m_root->state_value;
+    }
+    m_root->children.clear();
+    for (int i = 0; i < BOARD_SIZE; ++i) {
+        if (expanded[i]) {
+            auto value = visits[i] != 0 ? values[i] / visits[i] : 0.0;
+            auto child = m_policy->createNode(m_root.get(), i, -m_root->player, static_cast<float>(value), static_cast<float>(priors[i]));
+            child->node_visits = static_cast<size_t>(visits[i]);
+            m_root->children.push_back(std::move(child));
+        }
+    }
+    m_root->buildStats();
+    m_root->node_visits = root_visits;
+    m_root->state_value = root_visits ? static_cast<float>(root_value / root_visits) : 0.0f;
+    m_size = countNodes(m_root.get());
+    for (auto& tree : m_ensemble) {
+        m_size += tree->m_size;
+    }
+}
+
+// 每个待评估的叶结点占用一份棋盘拷贝，评估后悔棋回到初始局面以供下一轮复用。
+// 选出终局或已证明的结点时无需评估，直接反向传播，也不占用批次。
+void MCTS::runBatchedPlayouts(Board& board) {
+    Default::AddNoise(m_root.get());
+    m_policy->prepare(board);
+    auto exhausted = [&](size_t iterations) {
+        return c_constraint == Constraint::Duration ? timeUp() : iterations >= m_iterations;
+    };
+    vector<Board> boards(c_batch, board);
+    vector<Board*> pending;
+    vector<Node*> leaves;
+    vector<uint64_t> keys;
+    size_t iterations = 0;
+    while (!exhausted(iterations)) {
+        pending.clear(), leaves.clear(), keys.clear();
+        while (pending.size() < c_batch && !exhausted(iterations + pending.size())) {
+            auto& local = boards[pending.size()];
+            auto node = concurrentSelect(local);
+            m_stats.record(local.m_moveRecord.size() - m_policy->m_initActs);
+            if (node->proof != Node::Proof::None) { // 已证明的结点同样无需评估
+                Default::ConcurrentBackPropogate(node, node->state_value);
+                m_policy->revertMove(local, local.m_moveRecord.size() - m_policy->m_initActs);
+                ++iterations;
+            } else if (m_policy->checkGameEnd(local)) {
+                Default::ConcurrentBackPropogate(node, CalcScore(node->player, local.m_winner));
+                m_policy->revertMove(local, local.m_moveRecord.size() - m_policy->m_initActs);
+                ++iterations;
+            } else if (auto cached = m_table && m_policy->c_deterministic ? m_table->load(m_policy->hashKey(local)) : std::nullopt) {
+                auto& [state_value, action_probs] = *cached; // 置换表命中时无需等待批量评估
+                if (node->isLeaf() && underBudget(m_size)) {
+                    m_size += m_policy->expand(node, local, action_probs);
+                }
+                Default::ConcurrentBackPropogate(node, -state_value);
+                m_policy->revertMove(local, local.m_moveRecord.size() - m_policy->m_initActs);
+                ++iterations;
+            } else {
+                pending.push_back(&local);
+                leaves.push_back(node);
+                keys.push_back(m_table ? m_policy->hashKey(local) : 0);
+            }
+        }
+        if (pending.empty()) {
+            continue;
+        }
+        auto results = m_policy->batchSimulate(pending);
+        m_stats.evaluations += pending.size();
+        for (size_t i = 0; i < pending.size(); ++i) {
+            if (m_table && m_policy->c_deterministic) {
+                m_table->store(keys[i], results[i]);
+            }
+            auto& [state_value, action_probs] = results[i];
+            if (leaves[i]->isLeaf() && underBudget(m_size)) { // 同一批次中可能多次选到同一叶结点，只扩展一次
+                m_size += m_policy->expand(leaves[i], *pending[i], action_probs);
+            }
+            Default::ConcurrentBackPropogate(leaves[i], -state_value);
+            m_policy->revertMove(*pending[i], pending[i]->m_moveRecord.size() - m_policy->m_initActs);
+        }
+        iterations += pending.size();
+        m_size += m_policy->m_materialized.exchange(0, std::memory_order_relaxed);
+    }
+    if (c_constraint == Constraint::Duration) {
+        m_iterations = iterations;
     }
     m_policy->cleanup(board);
 }
 
-}
\ No newline at end of file
+}
@@ -1,7 +1,5 @@
 #include "Mapping.h"
 #include "Pattern.h"
-#include "utils/Persistence.h"
-#include <random>
 
 using namespace std;
 using namespace Gomoku;
@@ -39,8 +37,6 @@ Player BoardMap::applyMove(Position move) {
         const auto [index, offset] = ParseIndex(move, direction);
         m_lineMap[index][offset] = EncodeCharset(m_board->m_curPlayer == Player::Black ? 'x' : 'o');
     }
-	m_hash ^= BoardHash::HashPose(move, Player::None);
-	m_hash ^= BoardHash::HashPose(move, m_board->m_curPlayer);
     return m_board->applyMove(move, false);
 }
 
@@ -52,14 +48,11 @@ Player BoardMap::revertMove(size_t count) {
             m_lineMap[index][offset] = EncodeCharset('-');
         }
         m_board->revertMove();
-		m_hash ^= BoardHash::HashPose(move, m_board->m_curPlayer);
-		m_hash ^= BoardHash::HashPose(move, Player::None);
     }
     return m_board->m_curPlayer;
 }
 
 void BoardMap::reset() {
-    m_hash = 0ul;
     m_board->reset();
     for (auto& line : m_lineMap) {
         line.resize(MAX_PATTERN_LEN - 1, EncodeCharset('?')); // ǰԽλ('?')
@@ -69,28 +62,8 @@ void BoardMap::reset() {
 			auto[index, _] = ParseIndex(i, direction);
 			m_lineMap[index].push_back(EncodeCharset('-')); // ÿλλ('-')
 		}
-		m_hash ^= BoardHash::HashPose(i, Player::None);
 	}
     for (auto& line : m_lineMap) {
         line.append(MAX_PATTERN_LEN - 1, EncodeCharset('?')); // ߺԽλ('?')
     }
 }
-
-/* ------------------- BoardHashʵ ------------------- */
-
-const array<std::uint64_t[3], BOARD_SIZE> BoardHash::Zorbrist = []() {
-	array<std::uint64_t[3], BOARD_SIZE> keys;
-	auto data = Persistence::Load("zobrist");
-	if (data.is_null()) {
-		uniform_int_distribution<std::uint64_t> rnd;
-		mt19937_64 eng((random_device())()); // 64λ
-		for (int i = 0; i < BOARD_SIZE; ++i) {
-			data.push_back({ rnd(eng), rnd(eng), rnd(eng) });
-		}
-		Persistence::Save("zobrist", data); // dataǺܴ滹Ҫãʲmove
-	}
-	for (int i = 0; i < BOARD_SIZE; ++i) {
-		std::copy(begin(data[i]), end(data[i]), begin(keys[i]));
-	}
-	return keys;
-}();
\ No newline at end of file
@@ -0,0 +1,218 @@
+#include "OpeningBook.h"
+#include "MCTS.h"
+#include <algorithm>
+#include <fstream>
+#include <cstring>
+
+#if defined(_WIN32)
+#define NOMINMAX
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+using namespace std;
+
+namespace Gomoku {
+
+// 文件头，其后紧跟count条Entry
+struct BookHeader {
+    uint32_t magic = 0x424F4D47; // "GMOB"
+    uint16_t version = 1;
+    uint16_t entry_size = sizeof(OpeningBook::Entry);
+    uint16_t width = WIDTH;
+    uint16_t height = HEIGHT;
+    uint32_t reserved = 0;
+    uint64_t count = 0;
+};
+
+/* ------------------- 对称变换实现 ------------------- */
+
+Position OpeningBook::Transform(Position pose, int symmetry) {
+    int x = pose.x(), y = pose.y();
+    if (symmetry & 4) std::swap(x, y);
+    if (symmetry & 1) x = WIDTH - 1 - x;
+    if (symmetry & 2) y = HEIGHT - 1 - y;
+    return { x, y };
+}
+
+Position OpeningBook::Inverse(Position pose, int symmetry) {
+    int x = pose.x(), y = pose.y();
+    if (symmetry & 2) y = HEIGHT - 1 - y;
+    if (symmetry & 1) x = WIDTH - 1 - x;
+    if (symmetry & 4) std::swap(x, y);
+    return { x, y };
+}
+
+// 与Board::m_hash的构成一致：各棋子的键值，以及按已下手数的奇偶决定的应下方键值。
+// 键值相同时取序号最小的变换，生成与查询因此总是选中同一种变换。
+pair<uint64_t, int> OpeningBook::CanonicalKey(const Board& board) {
+    const uint64_t side = board.m_moveRecord.size() % 2 ? Board::ZobristKey(Player::None) : 0;
+    uint64_t keys[Symmetries];
+    std::fill(keys, keys + Symmetries, side);
+    for (auto player : { Player::Black, Player::White }) {
+        board.moveStates(player).forEach([&](Position pose) {
+            for (int s = 0; s < Symmetries; ++s) {
+                keys[s] ^= Board::ZobristKey(player, Transform(pose, s));
+            }
+        });
+    }
+    const auto best = std::min_element(keys, keys + Symmetries) - keys;
+    return { keys[best], static_cast<int>(best) };
+}
+
+/* ------------------- 文件映射实现 ------------------- */
+
+#if defined(_WIN32)
+
+struct OpeningBook::Mapping {
+    HANDLE file = INVALID_HANDLE_VALUE, mapping = nullptr;
+    const void* view = nullptr;
+    size_t size = 0;
+
+    ~Mapping() {
+        if (view) UnmapViewOfFile(view);
+        if (mapping) CloseHandle(mapping);
+        if (file != INVALID_HANDLE_VALUE) CloseHandle(file);
+    }
+
+    bool open(const string& path) {
+        file = CreateFileA(path.c_str(), GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, nullptr);
+        LARGE_INTEGER file_size;
+        if (file == INVALID_HANDLE_VALUE || !GetFileSizeEx(file, &file_size) || file_size.QuadPart == 0) {
+            return false;
+        }
+        size = static_cast<size_t>(file_size.QuadPart);
+        mapping = CreateFileMappingA(file, nullptr, PAGE_READONLY, 0, 0, nullptr);
+        view = mapping ? MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, 0) : nullptr;
+        return view != nullptr;
+    }
+};
+
+#else
+
+struct OpeningBook::Mapping {
+    const void* view = nullptr;
+    size_t size = 0;
+
+    ~Mapping() {
+        if (view) munmap(const_cast<void*>(view), size);
+    }
+
+    bool open(const string& path) {
+        int fd = ::open(path.c_str(), O_RDONLY);
+        if (fd < 0) {
+            return false;
+        }
+        struct stat st;
+        if (fstat(fd, &st) == 0 && st.st_size > 0) {
+            size = static_cast<size_t>(st.st_size);
+            auto addr = mmap(nullptr, size, PROT_READ, MAP_SHARED, fd, 0);
+            view = addr == MAP_FAILED ? nullptr : addr;
+        }
+        ::close(fd); // 映射在关闭文件后依然有效
+        return view != nullptr;
+    }
+};
+
+#endif
+
+/* ------------------- OpeningBook类实现 ------------------- */
+
+OpeningBook::OpeningBook() = default;
+
+OpeningBook::OpeningBook(const string& path) {
+    open(path);
+}
+
+OpeningBook::~OpeningBook() = default;
+
+bool OpeningBook::open(const string& path) {
+    close();
+    auto mapping = make_unique<Mapping>();
+    if (!mapping->open(path) || mapping->size < sizeof(BookHeader)) {
+        return false;
+    }
+    BookHeader header, expected;
+    std::memcpy(&header, mapping->view, sizeof(header));
+    if (header.magic != expected.magic || header.version != expected.version || header.entry_size != expected.entry_size
+        || header.width != expected.width || header.height != expected.height
+        || mapping->size != sizeof(BookHeader) + header.count * sizeof(Entry)) {
+        return false;
+    }
+    m_entries = reinterpret_cast<const Entry*>(static_cast<const char*>(mapping->view) + sizeof(BookHeader));
+    m_count = static_cast<size_t>(header.count);
+    m_mapping = std::move(mapping);
+    return true;
+}
+
+void OpeningBook::close() {
+    m_entries = nullptr;
+    m_count = 0;
+    m_mapping.reset();
+}
+
+vector<OpeningBook::Move> OpeningBook::probe(const Board& board) const {
+    vector<Move> moves;
+    if (m_count == 0) {
+        return moves;
+    }
+    auto [key, symmetry] = CanonicalKey(board);
+    auto first = std::lower_bound(m_entries, m_entries + m_count, key, [](const Entry& entry, uint64_t key) {
+        return entry.key < key;
+    });
+    for (auto entry = first; entry != m_entries + m_count && entry->key == key; ++entry) {
+        moves.push_back({ Inverse(entry->move, symmetry), entry->weight, entry->value });
+    }
+    return moves;
+}
+
+/* ------------------- OpeningBook::Builder类实现 ------------------- */
+
+void OpeningBook::Builder::add(const Board& board, Position move, size_t weight, float value) {
+    auto [key, symmetry] = CanonicalKey(board);
+    auto& stats = m_moves[{ key, Transform(move, symmetry).id }];
+    stats.weight += weight;
+    stats.value_sum += static_cast<double>(value) * weight;
+}
+
+// 结点的state_value即为对于走到该结点的一方的价值
+void OpeningBook::Builder::addTree(const Node* root, Board& board, size_t min_visits) {
+    for (auto&& child : root->children) {
+        if (child && child->node_visits >= min_visits) {
+            add(board, child->position, child->node_visits, child->state_value);
+            board.applyMove(child->position, false);
+            addTree(child.get(), board, min_visits);
+            board.revertMove();
+        }
+    }
+}
+
+bool OpeningBook::Builder::write(const string& path) const {
+    vector<Entry> entries;
+    entries.reserve(m_moves.size());
+    for (auto&& [key, stats] : m_moves) {
+        if (stats.weight > 0) {
+            const auto weight = static_cast<uint32_t>(std::min<double>(stats.weight, UINT32_MAX));
+            entries.push_back({ key.first, weight, static_cast<float>(stats.value_sum / stats.weight), key.second, 0 });
+        }
+    }
+    std::stable_sort(entries.begin(), entries.end(), [](const Entry& lhs, const Entry& rhs) {
+        return lhs.key != rhs.key ? lhs.key < rhs.key : lhs.weight > rhs.weight;
+    });
+
+    ofstream ofs(path, ios::binary | ios::trunc);
+    if (!ofs.is_open()) {
+        return false;
+    }
+    BookHeader header;
+    header.count = entries.size();
+    ofs.write(reinterpret_cast<const char*>(&header), sizeof(header));
+    ofs.write(reinterpret_cast<const char*>(entries.data()), entries.size() * sizeof(Entry));
+    return ofs.good();
+}
+
+}
@@ -19,6 +19,10 @@ inline void Game_Ext(py::module& mod) {
     mod.add_object("GameConfig", game_config);
 
 
+    // Seed the random engine of the calling thread for reproducible runs
+    mod.def("seed_random", &RandomEngine::Seed, py::arg("seed"));
+
+
     // Definition of Player enum class
     py::enum_<Player>(mod, "Player", "Gomoku player types")
         .value("white", Player::White)
@@ -54,10 +58,13 @@ inline void Game_Ext(py::module& mod) {
         .def("apply_move",  &Board::applyMove, py::arg("move"), py::arg("checkVictory") = true)
         .def("revert_move", &Board::revertMove, py::arg("count") = 1)
         .def("random_move", &Board::getRandomMove)
+        .def("random_candidate", &Board::getRandomCandidate)
         .def("check_move",  &Board::checkMove)
         .def("check_end",   &Board::checkGameEnd)
         .def("reset",       &Board::reset)
         .def_readonly("move_record", &Board::m_moveRecord)
+        .def_readonly("hash", &Board::m_hash, "Zobrist key of stones and side to move")
+        .def("hash_after", &Board::hashAfter, py::arg("move"))
         .def_property_readonly("last_move", [](const Board& b) {
             return b.m_moveRecord.empty() ? Position(-1) : b.m_moveRecord.back();
         })
@@ -72,10 +79,17 @@ inline void Game_Ext(py::module& mod) {
             py::dict move_states;
             for (auto player : { Player::Black, Player::None, Player::White }) {
                 // reshape to a square board
-                move_states[py::cast(player)] = py::array(py::dtype("uint8"), { HEIGHT, WIDTH }, b.moveStates(player).data()); 
+                py::array_t<unsigned char> states({ (int)HEIGHT, (int)WIDTH });
+                b.moveStates(player).unpack(states.mutable_data());
+                move_states[py::cast(player)] = states;
             }
             return move_states;
         })
+        .def_property_readonly("candidates", [](const Board& b) {
+            py::array_t<unsigned char> states({ (int)HEIGHT, (int)WIDTH });
+            b.candidates().unpack(states.mutable_data());
+            return states;
+        }, "Empty cells within CANDIDATE_RANGE of any stone")
         .def_property_readonly("status", [](const Board& b) {
             auto status = b.status();
             return py::dict(
@@ -89,7 +103,7 @@ inline void Game_Ext(py::module& mod) {
 
             int index = 0;  // index将在流式初始化过程中自增
             for (auto player : { b.m_curPlayer, -b.m_curPlayer, Player::None }) {
-                std::copy(b.moveStates(player).begin(), b.moveStates(player).end(), states.mutable_data(index++));
+                b.moveStates(player).unpack(states.mutable_data(index++));
             }
             for (int i = 0; i <= 1; ++index, ++i) {
                 std::fill(states.mutable_data(index), states.mutable_data(index) + HEIGHT * WIDTH, 0);
@@ -102,6 +116,38 @@ inline void Game_Ext(py::module& mod) {
 
             return states;
         }, "Feature planes: [X_t, Y_t, Z_t, y_t-1, x_t-2, C<is_black>]")
+        .def("compact", [](const Board& b) { return CompactBoard(b); }, "Pack into a CompactBoard snapshot")
         .def("__repr__", [](const Board& b) { return py::str("Board(cur_player: {})").format(std::to_string(b.m_curPlayer)); })
         .def("__str__",  [](const Board& b) { return std::to_string(b); });
+
+
+    // Definition of CompactBoard struct, whose planes are exported through the buffer protocol without copying
+    py::class_<CompactBoard>(mod, "CompactBoard", py::buffer_protocol(), "Compact 2-bit packed board snapshot")
+        .def(py::init<>())
+        .def(py::init<const Board&>(), py::arg("board"))
+        .def("to_board", &CompactBoard::toBoard)
+        .def_readonly("cur_player", &CompactBoard::curPlayer)
+        .def_property_readonly("last_moves", [](const CompactBoard& c) {
+            return py::make_tuple(c.lastMoves[0], c.lastMoves[1]);
+        })
+        .def_buffer([](CompactBoard& c) { // np.unpackbits(np.asarray(c), axis=-1, count=board_size, bitorder='little')
+            return py::buffer_info(
+                c.planes, sizeof(std::uint8_t), py::format_descriptor<std::uint8_t>::format(), 2,
+                { 2, (int)CompactBoard::PlaneBytes }, { (int)CompactBoard::PlaneBytes, 1 }
+            );
+        })
+        .def(py::pickle(
+            [](const CompactBoard& c) { return py::bytes(reinterpret_cast<const char*>(&c), sizeof(CompactBoard)); },
+            [](py::bytes data) {
+                CompactBoard c;
+                std::string raw = data;
+                if (raw.size() != sizeof(CompactBoard)) {
+                    throw std::runtime_error("CompactBoard pickled with a different board size");
+                }
+                std::copy(raw.begin(), raw.end(), reinterpret_cast<char*>(&c));
+                return c;
+            }
+        ))
+        .def("__repr__", [](const CompactBoard& c) { return py::str("CompactBoard(cur_player: {})").format(std::to_string(c.curPlayer)); })
+        .def("__str__",  [](const CompactBoard& c) { return std::to_string(c.toBoard()); });
 }
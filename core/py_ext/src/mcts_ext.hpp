@@ -1,5 +1,6 @@
 #include "pch.h"
 #include "lib/include/MCTS.h"
+#include "lib/include/OpeningBook.h"
 
 //using namespace Gomoku;
 //using namespace std;
@@ -8,8 +9,17 @@ inline void MCTS_Ext(py::module& mod) {
     // Expose the core lib namespace
     using namespace Gomoku;
     using namespace std;
+    using namespace py::literals;
 
-    py::class_<Node>(mod, "Node", "MCTS Tree Node")
+    py::class_<Node> node(mod, "Node", "MCTS Tree Node");
+
+    py::enum_<Node::Proof>(node, "Proof")
+        .value("none", Node::Proof::None)
+        .value("win",  Node::Proof::Win)
+        .value("loss", Node::Proof::Loss)
+        .value("draw", Node::Proof::Draw);
+
+    node
         .def(py::init<Node*, Position, Player, float, float>(),
             py::arg("parent") = nullptr,
             py::arg("position") = Position(-1),
@@ -20,13 +30,20 @@ inline void MCTS_Ext(py::module& mod) {
         .def_readonly("parent", &Node::parent)
         .def_readonly("position", &Node::position)
         .def_readonly("player", &Node::player)
-        .def_readwrite("state_value", &Node::state_value)
-        .def_readwrite("action_prob", &Node::action_prob)
-        .def_readwrite("node_visits", &Node::node_visits)
+        .def_property("state_value", 
+            [](const Node& n) { return static_cast<float>(n.state_value); }, 
+            [](Node& n, float v) { n.state_value = v, n.syncStats(); })
+        .def_property("action_prob", 
+            [](const Node& n) { return n.action_prob; }, 
+            [](Node& n, float p) { n.action_prob = p, n.syncStats(); })
+        .def_property("node_visits", 
+            [](const Node& n) { return static_cast<size_t>(n.node_visits); }, 
+            [](Node& n, size_t v) { n.node_visits = v, n.syncStats(); })
+        .def_readonly("proof", &Node::proof)
         .def_property_readonly("children", [](const Node* n) {
-            py::list children(n->children.size());
-            for (int i = 0; i < children.size(); ++i) {  // py::list do not support writing by iterator
-                children[i] = n->children[i].get();                
+            py::list children;
+            for (auto&& child : n->children) {  // skip slots not yet materialized by lazy expansion
+                if (child) children.append(child.get());
             }
             return children;
         })
@@ -34,19 +51,31 @@ inline void MCTS_Ext(py::module& mod) {
         .def("is_full", &Node::isFull)
         .def("__repr__", [](const Node* n) { 
             return py::str("Node(pose: {}, player: {}, value: {}, prob: {}, visits: {}, childs: {})").format(
-                n->position, n->player, n->state_value, n->action_prob, n->node_visits, n->children.size()
+                n->position, n->player, static_cast<float>(n->state_value), n->action_prob, static_cast<size_t>(n->node_visits), n->children.size()
             ); 
         });
 
 
+    // Node memory is shared by all trees through NodePool
+    mod.def("node_pool_stats", []() {
+        auto stats = NodePool::Stats();
+        return py::dict(
+            "live_nodes"_a = stats.live_nodes,
+            "live_bytes"_a = stats.live_bytes,
+            "reserved_bytes"_a = stats.reserved_bytes
+        );
+    }, "Live node count and bytes of all MCTS trees");
+
+
     // Register Policy class with shared_ptr holder type
     py::class_<Policy, std::shared_ptr<Policy>>(mod, "Policy", "MCTS Tree Policy")
-        .def(py::init<Policy::SelectFunc, Policy::ExpandFunc, Policy::EvalFunc, Policy::UpdateFunc, double>(),
+        .def(py::init<Policy::SelectFunc, Policy::ExpandFunc, Policy::EvalFunc, Policy::UpdateFunc, double, Policy::BatchEvalFunc>(),
             py::arg("select") = nullptr,
             py::arg("expand") = nullptr,
             py::arg("eval_state") = nullptr,
             py::arg("back_prop") = nullptr,
-            py::arg("c_puct") = C_PUCT
+            py::arg("c_puct") = C_PUCT,
+            py::arg("batch_eval_state") = nullptr
         )
         .def("prepare", &Policy::prepare)
         .def("clean_up", &Policy::cleanup)
@@ -54,30 +83,91 @@ inline void MCTS_Ext(py::module& mod) {
         .def("revert_move", &Policy::revertMove)
         .def("check_game_end", &Policy::checkGameEnd)
         .def("create_node", &Policy::createNode)
+        .def("is_concurrent", &Policy::isConcurrent)
+        .def("clone", &Policy::clone)
         .def_readonly("select", &Policy::select)
         .def_readonly("expand", &Policy::expand)
         .def_readonly("eval_state", &Policy::simulate)
         .def_readonly("back_prop", &Policy::backPropogate)
+        .def_readonly("batch_eval_state", &Policy::batchSimulate)
+        .def_readwrite("deterministic", &Policy::c_deterministic, "Whether eval_state is deterministic; only deterministic evaluations are cached")
         .def("__repr__", [](const Policy& p) { return py::str("Policy(c_puct: {}, init_acts: {})").format(p.c_puct, p.m_initActs); });
 
 
-    py::class_<MCTS>(mod, "MCTS", "Monte Carlo Tree Search")
-        .def(py::init<milliseconds, Position, Player, shared_ptr<Policy>>(),
+    py::class_<MCTS> mcts(mod, "MCTS", "Monte Carlo Tree Search");
+
+    py::enum_<MCTS::Parallelism>(mcts, "Parallelism")
+        .value("Tree", MCTS::Parallelism::Tree)
+        .value("Root", MCTS::Parallelism::Root);
+
+    mcts
+        .def(py::init<milliseconds, Position, Player, shared_ptr<Policy>, size_t, MCTS::Parallelism, size_t, size_t, size_t>(),
             py::arg("c_duration") = 960ms,
             py::arg("last_move") = Position(-1),
             py::arg("last_player") = Player::White,
-            py::arg_v("policy", nullptr, "Default Policy")
+            py::arg_v("policy", nullptr, "Default Policy"),
+            py::arg("c_threads") = 1,
+            py::arg("c_parallelism") = MCTS::Parallelism::Tree,
+            py::arg("c_batch") = 1,
+            py::arg("c_table_size") = 0,
+            py::arg("c_node_budget") = 0
         )
-        .def(py::init<size_t, Position, Player, shared_ptr<Policy>>(),
+        .def(py::init<size_t, Position, Player, shared_ptr<Policy>, size_t, MCTS::Parallelism, size_t, size_t, size_t>(),
             py::arg("c_iterations"),
             py::arg("last_move") = Position(-1),
             py::arg("last_player") = Player::White,
-            py::arg_v("policy", nullptr, "Default Policy")
+            py::arg_v("policy", nullptr, "Default Policy"),
+            py::arg("c_threads") = 1,
+            py::arg("c_parallelism") = MCTS::Parallelism::Tree,
+            py::arg("c_batch") = 1,
+            py::arg("c_table_size") = 0,
+            py::arg("c_node_budget") = 0
         )
         .def_readonly("size", &MCTS::m_size)
         .def_readonly("iterations", &MCTS::m_iterations)
         .def_readonly("duration", &MCTS::m_duration)
+        .def_readonly("threads", &MCTS::c_threads)
+        .def_readonly("parallelism", &MCTS::c_parallelism)
+        .def_readonly("batch", &MCTS::c_batch)
+        .def_readwrite("node_budget", &MCTS::c_nodeBudget)
+        .def_readwrite("seed", &MCTS::c_seed, "Seed of the deterministic mode, None to disable")
+        .def_property("game_budget", 
+            [](const MCTS& m) { return m.m_timer.c_gameBudget; }, 
+            [](MCTS& m, milliseconds budget) { m.m_timer.setBudget(budget); }
+        )
+        .def_property_readonly("remaining", [](const MCTS& m) { return m.m_timer.m_remaining; })
+        .def_property_readonly("elapsed", [](const MCTS& m) { return m.m_timer.m_elapsed; })
+        .def_property_readonly("table_stats", [](const MCTS& m) -> py::object {
+            if (!m.m_table) return py::none();
+            return py::dict(
+                "capacity"_a = m.m_table->capacity(),
+                "memory"_a = m.m_table->memory(),
+                "probes"_a = m.m_table->m_probes.load(),
+                "hits"_a = m.m_table->m_hits.load()
+            );
+        })
+        .def_property_readonly("stats", [](const MCTS& m) {
+            auto& s = m.m_stats;
+            auto seconds = [&](SearchStats::Phase phase) { return chrono::duration<double>(s.phaseTime(phase)).count(); };
+            return py::dict(
+                "playouts"_a = s.playouts,
+                "playouts_per_sec"_a = s.playoutsPerSecond(),
+                "nodes_created"_a = s.nodes_created,
+                "pruned"_a = s.pruned,
+                "avg_depth"_a = s.averageDepth(),
+                "max_depth"_a = s.max_depth,
+                "reused_nodes"_a = s.reused_nodes,
+                "reuse_ratio"_a = s.reuseRatio(),
+                "evaluations"_a = s.evaluations,
+                "duration"_a = s.duration,
+                "select"_a = seconds(SearchStats::Select),
+                "expand"_a = seconds(SearchStats::Expand),
+                "simulate"_a = seconds(SearchStats::Simulate),
+                "backprop"_a = seconds(SearchStats::BackPropogate)
+            );
+        }, "Statistics of the last search; phase times in seconds are estimated from sampled playouts")
         .def_property_readonly("root", [](const MCTS& m) { return m.m_root.get(); })
+        .def("solved", &MCTS::solved)
         .def_property_readonly("policy", [](const MCTS& m) { return m.m_policy.get(); })
         .def("get_action", &MCTS::getAction)
         .def("eval_state", &MCTS::evalState)
@@ -85,5 +175,36 @@ inline void MCTS_Ext(py::module& mod) {
         .def("step_forward", [](MCTS& m, Position p) { m.stepForward(p); }, py::arg("next_move"))
         .def("sync_with_board", &MCTS::syncWithBoard)
         .def("reset", &MCTS::reset)
+        .def("prune", &MCTS::prune)
+        .def("wait_for_release", &MCTS::waitForRelease, py::call_guard<py::gil_scoped_release>())
+        .def("save", &MCTS::save, py::arg("path"), py::arg("board"))
+        .def("load", &MCTS::load, py::arg("path"), py::arg("board"))
         .def("__repr__", [](const MCTS& m) { return py::str("MCTS(root_player: {}, nodes: {})").format(m.m_root->player, m.m_size); });
+
+
+    // Opening book is memory-mapped and read-only; books are built offline by OpeningBookBuilder
+    py::class_<OpeningBook, shared_ptr<OpeningBook>>(mod, "OpeningBook", "Memory-mapped opening book")
+        .def(py::init<>())
+        .def(py::init<const string&>(), py::arg("path"))
+        .def("open", &OpeningBook::open, py::arg("path"))
+        .def("close", &OpeningBook::close)
+        .def("is_open", &OpeningBook::isOpen)
+        .def("__len__", &OpeningBook::size)
+        .def("probe", [](const OpeningBook& b, const Board& board) {
+            py::list moves;
+            for (auto&& m : b.probe(board)) {
+                moves.append(py::make_tuple(m.move, m.weight, m.value));
+            }
+            return moves;
+        }, py::arg("board"), "List of (move, weight, value) sorted by weight")
+        .def_static("canonical_key", &OpeningBook::CanonicalKey, py::arg("board"));
+
+    py::class_<OpeningBook::Builder>(mod, "OpeningBookBuilder")
+        .def(py::init<>())
+        .def("add", &OpeningBook::Builder::add, py::arg("board"), py::arg("move"), py::arg("weight") = 1, py::arg("value") = 0.0f)
+        .def("add_tree", [](OpeningBook::Builder& b, const MCTS& m, Board board, size_t min_visits) {
+            b.addTree(m.m_root.get(), board, min_visits);
+        }, py::arg("mcts"), py::arg("board"), py::arg("min_visits"))
+        .def("write", &OpeningBook::Builder::write, py::arg("path"))
+        .def("__len__", &OpeningBook::Builder::size);
 }
\ No newline at end of file
@@ -10,27 +10,29 @@ inline void Policy_Ext(py::module& mod) {
 
     py::class_<RandomPolicy, Policy, std::shared_ptr<RandomPolicy>>
         (mod, "RandomPolicy", "Random policy with averaged mutliple rollouts")
-        .def(py::init<double, size_t>(),
+        .def(py::init<double, size_t, bool>(),
             py::arg("c_puct") = C_PUCT,
-            py::arg("c_rollouts") = 5
+            py::arg("c_rollouts") = 5,
+            py::arg("c_nearby") = false
         )
         .def("__repr__", [](const RandomPolicy& p) { 
             return py::str(
-                "RandomPolicy(c_puct: {}, c_rollouts: {}, init_acts: {})"
-            ).format(p.c_puct, p.c_rollouts, p.m_initActs); 
+                "RandomPolicy(c_puct: {}, c_rollouts: {}, c_nearby: {}, init_acts: {})"
+            ).format(p.c_puct, p.c_rollouts, p.c_nearby, p.m_initActs); 
         });
 
 
     py::class_<PoolRAVEPolicy, Policy, std::shared_ptr<PoolRAVEPolicy>>
         (mod, "PoolRAVEPolicy", "PoolRAVE policy with MC-RAVE algorithm")
-        .def(py::init<double, double>(),
+        .def(py::init<double, double, bool>(),
             py::arg("c_puct") = 2,
-            py::arg("c_bias") = 0
+            py::arg("c_bias") = 0,
+            py::arg("c_nearby") = false
         )
         .def("__repr__", [](const PoolRAVEPolicy& p) { 
             return py::str(
-                "PoolRAVEPolicy(c_puct: {}, c_bias: {}, init_acts: {})"
-            ).format(p.c_puct, p.c_bias, p.m_initActs); 
+                "PoolRAVEPolicy(c_puct: {}, c_bias: {}, c_nearby: {}, init_acts: {})"
+            ).format(p.c_puct, p.c_bias, p.c_nearby, p.m_initActs); 
         });
 
 
@@ -98,12 +98,13 @@ TEST_F(BoardTest, CheckVictory) {
 TEST_F(BoardTest, CheckTie) {
     for (int j = 0; j < HEIGHT; ++j) {
         // y的映射方式为：
-        // 低HEIGHT/2位：由0位开始，每位映射为0,2,4,6,8...
+        // 低(HEIGHT+1)/2位：由0位开始，每位映射为0,2,4,6,8...
         // 高HEIGHT/2位：由(HEIGHT+1)/2位开始，每位映射为1,3,5,7,9...
-        int y = j <= HEIGHT/2 ? 2*j : 2*(j - HEIGHT/2) - 1;
+        int y = j < (HEIGHT+1)/2 ? 2*j : 2*(j - (HEIGHT+1)/2) + 1;
         for (int i = 0; i < WIDTH; ++i) {
             // x的映射方式为：i -> x
-            int x = i;
+            // 宽度为偶数时，每行都由黑棋开始，需按(y/2)%2错开一格，避免同一列与斜线上颜色连续
+            int x = WIDTH % 2 == 1 ? i : (i + y / 2 % 2) % WIDTH;
             // 下棋到{x, y}并进行相关检查
             Player result = board.applyMove({x, y});
             ASSERT_TRUE(trivialCheck(board));
@@ -153,3 +154,192 @@ TEST_F(BoardTest, RandomRollout) {
         ASSERT_EQ(result, curPlayer); // result一定得为当前玩家（当前玩家需要重下）
     }
 }
+
+// 快照检查：随机下完一盘后通过restore一次性回到快照局面
+TEST_F(BoardTest, SnapshotRestore) {
+    Position positions[caseSize];
+    randomlyFill(std::begin(positions), std::end(positions));
+    for (auto move : positions) {
+        board.applyMove(move);
+    }
+    Board board_cpy(board);
+    auto snapshot = board.snapshot();
+    while (board.applyMove(board.getRandomMove()) != Player::None);
+    ASSERT_TRUE(trivialCheck(board));
+    board.restore(snapshot);
+    ASSERT_TRUE(trivialCheck(board));
+    EXPECT_EQ(board, board_cpy) << "board does not remain the same after restored from snapshot";
+    for (int i = 0; i < BOARD_SIZE; ++i) {
+        for (auto player : { Player::Black, Player::None, Player::White }) {
+            ASSERT_EQ(board.moveState(player, i), board_cpy.moveState(player, i));
+        }
+    }
+}
+
+// 连珠检测：四个方向及棋盘边缘的五连都应判胜，跨行首尾相接的五子不应判胜
+TEST_F(BoardTest, CheckVictoryDirections) {
+    const std::pair<int, int> directions[] = { {1, 0}, {0, 1}, {1, 1}, {-1, 1} };
+    const Position origins[] = { {0, 0}, {WIDTH - 1, 0}, {0, HEIGHT - MAX_RENJU}, {WIDTH / 2, HEIGHT / 2} };
+    for (auto [dx, dy] : directions) {
+        for (auto origin : origins) {
+            int x0 = origin.x(), y0 = origin.y();
+            if (!board.checkBoundary(x0 + (MAX_RENJU - 1) * dx, y0 + (MAX_RENJU - 1) * dy)) {
+                continue;
+            }
+            board.reset();
+            for (int i = 0; i < MAX_RENJU; ++i) {
+                // 最后一手下在连珠中部，以检查窗口两侧均被覆盖
+                int k = (i + 3) % MAX_RENJU;
+                auto result = board.applyMove({ x0 + k * dx, y0 + k * dy });
+                if (i == MAX_RENJU - 1) {
+                    ASSERT_EQ(result, Player::None);
+                    ASSERT_EQ(board.m_winner, Player::Black);
+                } else {
+                    ASSERT_EQ(result, Player::White);
+                    // 白棋只有MAX_RENJU-1手，不可能获胜；只需避开黑棋的连珠线即可
+                    Position white = 0;
+                    while (!board.checkMove(white) || (white.x() - x0) * dy == (white.y() - y0) * dx) {
+                        white.id += 1;
+                    }
+                    ASSERT_EQ(board.applyMove(white), Player::Black);
+                }
+            }
+        }
+    }
+    // 跨越行尾与下一行行首的五子，在位图中是连续的，但不构成连珠
+    board.reset();
+    for (int i = 0; i < MAX_RENJU; ++i) {
+        ASSERT_EQ(board.applyMove(WIDTH - 3 + i), Player::White);
+        ASSERT_EQ(board.applyMove({ 2 * i, HEIGHT - 1 }), Player::Black);
+    }
+}
+
+// 随机落点检查：悔棋与快照恢复后，随机落点仍只落在空位上，且在空位间均匀分布
+TEST_F(BoardTest, RandomMoveUniform) {
+    for (int i = 0; i < BOARD_SIZE / 2; ++i) {
+        board.applyMove(board.getRandomMove(), false);
+    }
+    board.revertMove(BOARD_SIZE / 4);
+    auto snapshot = board.snapshot();
+    for (int i = 0; i < BOARD_SIZE / 4; ++i) {
+        board.applyMove(board.getRandomMove(), false);
+    }
+    board.restore(snapshot);
+    board.revertMove(BOARD_SIZE / 8);
+    const int samples = 400;
+    const int empty_count = board.moveCounts(Player::None);
+    std::vector<int> counts(BOARD_SIZE, 0);
+    for (int i = 0; i < samples * empty_count; ++i) {
+        auto move = board.getRandomMove();
+        ASSERT_TRUE(board.checkMove(move));
+        counts[move] += 1;
+    }
+    for (int i = 0; i < BOARD_SIZE; ++i) {
+        if (board.moveState(Player::None, i)) {
+            EXPECT_NEAR(counts[i], samples, samples * 0.3) << "biased at " << std::to_string(Position(i));
+        }
+    }
+}
+
+// 紧凑快照检查：打包后再解包，棋盘状态、胜负与最后两手都应保持不变
+TEST_F(BoardTest, CompactRoundTrip) {
+    if (BOARD_SIZE == 15 * 15) {
+        EXPECT_EQ(sizeof(CompactBoard), 64);
+    }
+    for (int round = 0; round < 10; ++round) {
+        board.reset();
+        for (int i = 0, n = rand() % BOARD_SIZE; i < n && board.m_curPlayer != Player::None; ++i) {
+            board.applyMove(board.getRandomMove());
+        }
+        auto restored = CompactBoard(board).toBoard();
+        ASSERT_TRUE(trivialCheck(restored));
+        EXPECT_EQ(restored.status().curPlayer, board.status().curPlayer);
+        EXPECT_EQ(restored.status().winner, board.status().winner);
+        for (int i = 0; i < BOARD_SIZE; ++i) {
+            for (auto player : { Player::Black, Player::None, Player::White }) {
+                ASSERT_EQ(restored.moveState(player, i), board.moveState(player, i));
+            }
+        }
+        for (size_t i = 0; i < 2 && i < board.m_moveRecord.size(); ++i) {
+            EXPECT_EQ(restored.m_moveRecord.rbegin()[i], board.m_moveRecord.rbegin()[i]);
+        }
+    }
+}
+
+// Zobrist键值检查：与落子顺序无关，悔棋与恢复快照后应还原，hashAfter应与实际落子一致
+TEST_F(BoardTest, ZobristHash) {
+    EXPECT_EQ(board.m_hash, 0);
+    std::vector<Position> moves;
+    for (int i = 0; i < 4 * caseSize; ++i) {
+        moves.push_back(board.getRandomMove());
+        auto expected = board.hashAfter(moves.back());
+        board.applyMove(moves.back(), false);
+        ASSERT_EQ(board.m_hash, expected);
+    }
+    const auto hash = board.m_hash;
+
+    // 交换同一玩家的两手棋，得到相同局面
+    Board transposed;
+    std::swap(moves[0], moves[2]);
+    std::swap(moves[1], moves[3]);
+    for (auto move : moves) {
+        transposed.applyMove(move, false);
+    }
+    EXPECT_EQ(transposed.m_hash, hash);
+    EXPECT_EQ(std::hash<Board>()(transposed), std::hash<Board>()(board));
+
+    // 棋子相同而应下方不同的局面键值应不同
+    transposed.revertMove();
+    EXPECT_NE(transposed.m_hash, hash);
+
+    auto snapshot = board.snapshot();
+    board.applyMove(board.getRandomMove(), false);
+    EXPECT_NE(board.m_hash, hash);
+    board.restore(snapshot);
+    EXPECT_EQ(board.m_hash, hash);
+
+    board.revertMove(4 * caseSize);
+    EXPECT_EQ(board.m_hash, 0);
+}
+
+// 邻域候选点集检查：下棋、悔棋与恢复快照后，均应与按定义暴力求得的结果一致
+TEST_F(BoardTest, NeighborCandidates) {
+    auto expected = [](const Board& board) {
+        BitBoard candidates;
+        for (int i = 0; i < BOARD_SIZE; ++i) {
+            for (auto move : board.m_moveRecord) {
+                if (board.moveState(Player::None, i) && 
+                    std::abs(move.x() - Position(i).x()) <= CANDIDATE_RANGE && 
+                    std::abs(move.y() - Position(i).y()) <= CANDIDATE_RANGE) {
+                    candidates.set(i);
+                }
+            }
+        }
+        return candidates;
+    };
+    auto check = [&](const Board& board) {
+        const auto candidates = expected(board);
+        return std::equal(begin(candidates.words), end(candidates.words), begin(board.candidates().words));
+    };
+
+    EXPECT_EQ(board.candidates().count(), 0);
+    EXPECT_TRUE(board.checkMove(board.getRandomCandidate())); // 空棋盘时退化为全盘随机
+    for (int round = 0; round < caseSize; ++round) {
+        board.reset();
+        while (board.m_curPlayer != Player::None) {
+            auto move = board.getRandomCandidate();
+            ASSERT_TRUE(board.candidates().test(move) || board.candidates().count() == 0);
+            board.applyMove(move);
+            ASSERT_TRUE(check(board));
+        }
+        auto snapshot = (board.revertMove(board.m_moveRecord.size() / 2), board.snapshot());
+        while (board.applyMove(board.getRandomCandidate()) != Player::None);
+        board.restore(snapshot);
+        ASSERT_TRUE(check(board));
+        while (!board.m_moveRecord.empty()) {
+            board.revertMove();
+            ASSERT_TRUE(check(board));
+        }
+        EXPECT_EQ(board.candidates().count(), 0);
+    }
+}
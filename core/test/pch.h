@@ -15,9 +15,9 @@ namespace Gomoku {
 
 inline bool operator==(const Board& lhs, const Board& rhs) {
     // 为加快速度，只检查moveStates元素个数及棋谱记录是否相等，就不检查每个元素是否一一对应了
-    // 注意m_moveStates与m_moveCounts都不是std::array，而是原生数组，因此不能直接用来比较
+    // 注意moveCounts由popcount即时求得，因此只能按值比较
     auto make_tied = [](const Board& b) {
-        return std::tie(b.m_curPlayer, b.m_winner, b.m_moveCounts[0], b.m_moveCounts[1], b.m_moveCounts[2], b.m_moveRecord);
+        return std::make_tuple(b.m_curPlayer, b.m_winner, b.moveCounts(Player::White), b.moveCounts(Player::None), b.moveCounts(Player::Black), std::cref(b.m_moveRecord));
     };
     return make_tied(lhs) == make_tied(rhs);
 }
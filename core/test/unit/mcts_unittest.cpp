@@ -1,6 +1,10 @@
 #include "pch.h"
 #include "lib/include/MCTS.h"
 #include "lib/include/policies/Traditional.h"
+#include "lib/include/policies/Random.h"
+#include "lib/include/policies/PoolRAVE.h"
+#include <map>
+#include <future>
 
 using namespace Gomoku;
 using namespace Gomoku::Policies;
@@ -39,4 +43,815 @@ using namespace Gomoku::Policies;
 //        board.applyMove(next_move);
 //        board_cpy.applyMove(next_move);
 //    }
-//}
\ No newline at end of file
+//}
+
+// 惰性扩展时尚未创建的子结点（空指针）不计入
+static size_t CountTree(const Node* node) {
+    size_t count = 1;
+    for (auto&& child : node->children) {
+        if (child) {
+            count += CountTree(child.get());
+        }
+    }
+    return count;
+}
+
+// 统计Simulate调用次数的静态策略。评估结果只依赖局面：价值由局面的键值导出，概率为邻域候选点上的均匀分布。
+class CountingPolicy final : public StaticPolicy<CountingPolicy> {
+public:
+    CountingPolicy() { c_deterministic = true; }
+
+    virtual bool isConcurrent() const override { return true; }
+
+    EvalResult Simulate(Board& board) {
+        ++m_calls;
+        return { static_cast<float>(board.m_hash % 201) / 100.0f - 1.0f, Default::CandidateProbs(board) };
+    }
+
+    std::atomic<size_t> m_calls = 0;
+};
+
+// 析构时等待闸门打开的结点，用于模拟耗时的后台释放
+struct GatedNode : public Node {
+    using Node::Node;
+    ~GatedNode() {
+        while (!s_open.load()) {
+            std::this_thread::yield();
+        }
+    }
+    static inline std::atomic<bool> s_open = true;
+};
+
+// 使用默认算法、创建GatedNode的策略
+class GatedPolicy : public Policy {
+public:
+    virtual std::unique_ptr<Node> createNode(Node* parent, Position pose, Player player, float value, float prob) override {
+        return std::unique_ptr<Node>(new GatedNode(parent, pose, player, value, prob));
+    }
+};
+
+// 结点计数检查：m_size应与树的实际结点数一致，内存池的存活结点数应随树的释放（后台释放完毕后）而回落
+TEST(MCTSTest, NodeAccounting) {
+    const auto baseline = NodePool::Stats();
+    for (auto policy : { std::shared_ptr<Policy>(new RandomPolicy(C_PUCT, 1)), std::shared_ptr<Policy>(new PoolRAVEPolicy) }) {
+        {
+            Board board;
+            MCTS mcts(size_t(200), -1, Player::White, policy);
+            for (int i = 0; i < 4; ++i) {
+                board.applyMove(mcts.getAction(board));
+                mcts.waitForRelease();
+                EXPECT_EQ(mcts.m_size, CountTree(mcts.m_root.get()));
+                EXPECT_EQ(NodePool::Stats().live_nodes - baseline.live_nodes, mcts.m_size);
+            }
+            board.applyMove(board.getRandomMove()); // 不在树中的一手
+            mcts.syncWithBoard(board);
+            mcts.waitForRelease();
+            EXPECT_EQ(mcts.m_size, CountTree(mcts.m_root.get()));
+            EXPECT_EQ(NodePool::Stats().live_nodes - baseline.live_nodes, mcts.m_size);
+            EXPECT_GE(NodePool::Stats().reserved_bytes, NodePool::Stats().live_bytes);
+        }
+        EXPECT_EQ(NodePool::Stats().live_nodes, baseline.live_nodes);
+        EXPECT_EQ(NodePool::Stats().live_bytes, baseline.live_bytes);
+    }
+}
+
+// 换根不等待后台释放：被丢弃结点的析构被阻塞时，跨越两手的syncWithBoard（两次换根）仍应立即返回
+TEST(MCTSTest, NonBlockingRelease) {
+    using namespace std::chrono_literals;
+    const auto baseline = NodePool::Stats();
+    {
+        Board board;
+        MCTS mcts(size_t(3000), -1, Player::White, std::make_shared<GatedPolicy>());
+        mcts.evalState(board); // 不换根，保留整棵树
+        auto most_visited = [](const Node* node) {
+            const Node* best = nullptr;
+            for (auto&& child : node->children) {
+                if (child && (!best || child->node_visits > best->node_visits)) {
+                    best = child.get();
+                }
+            }
+            return best;
+        };
+        auto first = most_visited(mcts.m_root.get());
+        ASSERT_NE(first, nullptr);
+        auto second = most_visited(first);
+        ASSERT_NE(second, nullptr);
+        board.applyMove(first->position);
+        board.applyMove(second->position);
+
+        GatedNode::s_open = false;
+        auto sync = std::async(std::launch::async, [&] { mcts.syncWithBoard(board); });
+        auto status = sync.wait_for(5s);
+        GatedNode::s_open = true;
+        sync.wait();
+        EXPECT_EQ(status, std::future_status::ready);
+        EXPECT_EQ(mcts.m_root->position, board.m_moveRecord.back());
+
+        mcts.waitForRelease();
+        EXPECT_EQ(mcts.m_size, CountTree(mcts.m_root.get()));
+        EXPECT_EQ(NodePool::Stats().live_nodes - baseline.live_nodes, mcts.m_size);
+    }
+    EXPECT_EQ(NodePool::Stats().live_nodes, baseline.live_nodes);
+}
+
+// SoA镜像检查：搜索后各结点的镜像应与子结点属性一致，向量化Select应与逐个计算的结果一致
+// 惰性扩展时尚未创建的子结点，其镜像中的价值与访问次数应为0
+TEST(MCTSTest, ChildStatsMirror) {
+    using Algorithms::Default;
+    std::function<void(const Node*)> check = [&](const Node* node) {
+        for (size_t i = 0; i < node->children.size(); ++i) {
+            auto child = node->children[i].get();
+            if (child == nullptr) {
+                ASSERT_EQ(node->childValues()[i], 0.0f);
+                ASSERT_EQ(node->childVisits()[i], 0.0f);
+                continue;
+            }
+            ASSERT_EQ(child->index, i);
+            ASSERT_EQ(node->childPosition(i), child->position);
+            ASSERT_EQ(node->childPriors()[i], child->action_prob);
+            ASSERT_EQ(node->childValues()[i], child->state_value);
+            ASSERT_EQ(node->childVisits()[i], child->node_visits);
+            check(child);
+        }
+    };
+    for (auto policy : { std::shared_ptr<Policy>(new RandomPolicy(C_PUCT, 1)), std::shared_ptr<Policy>(new PoolRAVEPolicy) }) {
+        Board board;
+        MCTS mcts(size_t(300), -1, Player::White, policy);
+        board.applyMove(mcts.getAction(board));
+        mcts.syncWithBoard(board);
+        check(mcts.m_root.get());
+
+        auto root = mcts.m_root.get();
+        Position expected;
+        double max_score = -INFINITY;
+        for (size_t i = 0; i < root->children.size(); ++i) {
+            Node lazy(root, root->childPosition(i), -root->player, 0.0f, root->childPriors()[i]);
+            auto child = root->children[i] ? root->children[i].get() : &lazy;
+            auto score = child->state_value + Default::PUCB(child, policy->c_puct);
+            if (score > max_score) {
+                max_score = score, expected = child->position;
+            }
+        }
+        EXPECT_EQ(Default::Select(policy.get(), root)->position, expected);
+    }
+}
+
+// 默认扩展全部空位；c_nearby为真时只扩展邻域候选点
+TEST(MCTSTest, NearbyExpansion) {
+    Board board;
+    board.applyMove(Position(7, 7));
+    for (bool nearby : { false, true }) {
+        for (auto policy : { std::shared_ptr<Policy>(new RandomPolicy(C_PUCT, 1, nearby)), std::shared_ptr<Policy>(new PoolRAVEPolicy(1e-4, 1e-1, nearby)) }) {
+            MCTS mcts(size_t(10), -1, Player::White, policy);
+            mcts.evalState(board);
+            EXPECT_EQ(mcts.m_root->children.size(), nearby ? board.candidates().count() : board.moveCounts(Player::None));
+        }
+    }
+}
+
+// 惰性扩展只在Select与BackPropogate均为默认时启用；RAVE的反向传播应跳过尚未创建的子结点
+TEST(MCTSTest, LazyExpansionGuard) {
+    using Algorithms::Default;
+    using Algorithms::RAVE;
+    std::function<void(const Node*)> check = [&](const Node* node) {
+        for (auto&& child : node->children) {
+            ASSERT_NE(child, nullptr);
+            check(child.get());
+        }
+    };
+    std::shared_ptr<Policy> policy;
+    policy = std::make_shared<Policy>(nullptr, nullptr, nullptr, [&policy](Node* node, Board& board, double value) {
+        RAVE::BackPropogate<false>(policy.get(), node, board, static_cast<float>(value));
+    });
+    Board board;
+    MCTS mcts(size_t(300), -1, Player::White, policy);
+    board.applyMove(mcts.getAction(board));
+    mcts.syncWithBoard(board);
+    check(mcts.m_root.get());
+
+    auto lazy = std::make_shared<RandomPolicy>(C_PUCT, 1);
+    Node root;
+    Default::LazyExpand(lazy.get(), &root, board, Default::UniformProbs(board));
+    ASSERT_FALSE(root.children.empty());
+    RAVE::BackPropogate<false>(lazy.get(), &root, board, 1.0f);
+    EXPECT_EQ(root.node_visits, 1);
+    for (auto&& child : root.children) {
+        EXPECT_EQ(child, nullptr);
+    }
+}
+
+// 树并行检查：虚拟损失应被完全撤销，根结点访问次数与迭代次数一致，结点计数与镜像保持正确
+TEST(MCTSTest, ConcurrentPlayouts) {
+    std::function<void(const Node*)> check = [&](const Node* node) {
+        size_t child_visits = 0;
+        for (size_t i = 0; i < node->children.size(); ++i) {
+            auto child = node->children[i].get();
+            if (child == nullptr) {
+                ASSERT_EQ(node->childVisits()[i], 0.0f);
+                continue;
+            }
+            ASSERT_EQ(node->childVisits()[i], child->node_visits);
+            ASSERT_EQ(node->childValues()[i], child->state_value);
+            ASSERT_LE(std::abs(child->state_value), 1.0f + 1e-4f);
+            child_visits += child->node_visits;
+            check(child);
+        }
+        ASSERT_LE(child_visits, node->node_visits);
+    };
+    Board board;
+    auto policy = std::make_shared<RandomPolicy>(C_PUCT, 1);
+    MCTS mcts(size_t(2000), -1, Player::White, policy, 4);
+    for (int i = 0; i < 3; ++i) {
+        auto move = mcts.getAction(board);
+        ASSERT_EQ(mcts.m_root->position, move);
+        EXPECT_EQ(mcts.m_size, CountTree(mcts.m_root.get()));
+        check(mcts.m_root.get());
+        board.applyMove(move);
+    }
+    mcts.syncWithBoard(board);
+    const size_t visits = mcts.m_root->node_visits;
+    mcts.evalState(board);
+    EXPECT_EQ(mcts.m_root->node_visits, visits + 2000);
+    EXPECT_EQ(board.m_moveRecord.size(), 3);
+}
+
+// 根并行检查：汇总后的访问次数应等于各棵树之和，换根后各棵树的根结点应与汇总树一致
+TEST(MCTSTest, EnsemblePlayouts) {
+    for (auto policy : { std::shared_ptr<Policy>(new RandomPolicy(C_PUCT, 1)), std::shared_ptr<Policy>(new PoolRAVEPolicy) }) {
+        Board board;
+        MCTS mcts(size_t(300), -1, Player::White, policy, 3, MCTS::Parallelism::Root);
+        ASSERT_EQ(mcts.m_ensemble.size(), 3);
+        for (int i = 0; i < 3; ++i) {
+            mcts.evalState(board);
+            size_t visits = 0, size = CountTree(mcts.m_root.get());
+            for (auto& tree : mcts.m_ensemble) {
+                EXPECT_EQ(tree->m_root->position, mcts.m_root->position);
+                visits += tree->m_root->node_visits;
+                size += tree->m_size;
+            }
+            EXPECT_EQ(mcts.m_root->node_visits, visits);
+            EXPECT_EQ(mcts.m_size, size);
+            board.applyMove(mcts.stepForward()->position);
+            for (auto& tree : mcts.m_ensemble) {
+                EXPECT_EQ(tree->m_root->position, board.m_moveRecord.back());
+                EXPECT_EQ(tree->m_size, CountTree(tree->m_root.get()));
+            }
+        }
+    }
+}
+
+// 批量评估检查：每次回调的局面互不相同且不超过批大小，访问次数与结点计数保持正确
+TEST(MCTSTest, BatchedPlayouts) {
+    auto base = std::make_shared<RandomPolicy>(C_PUCT, 1);
+    size_t calls = 0, evaluated = 0;
+    auto policy = std::make_shared<Policy>(nullptr, nullptr, nullptr, nullptr, C_PUCT,
+        [&](const std::vector<Board*>& boards) {
+            EXPECT_LE(boards.size(), 8);
+            std::vector<Policy::EvalResult> results;
+            for (auto board : boards) {
+                EXPECT_EQ(std::count(boards.begin(), boards.end(), board), 1);
+                results.push_back(base->simulate(*board));
+            }
+            ++calls, evaluated += boards.size();
+            return results;
+        }
+    );
+    Board board;
+    MCTS mcts(size_t(400), -1, Player::White, policy, 1, MCTS::Parallelism::Tree, 8);
+    for (int i = 0; i < 3; ++i) {
+        auto move = mcts.getAction(board);
+        EXPECT_EQ(mcts.m_size, CountTree(mcts.m_root.get()));
+        for (size_t j = 0; j < mcts.m_root->children.size(); ++j) {
+            auto child = mcts.m_root->children[j].get();
+            ASSERT_EQ(mcts.m_root->childVisits()[j], child ? size_t(child->node_visits) : 0);
+        }
+        board.applyMove(move);
+    }
+    EXPECT_GT(calls, 0);
+    EXPECT_GT(evaluated, calls);
+    mcts.syncWithBoard(board);
+    const size_t visits = mcts.m_root->node_visits;
+    mcts.evalState(board);
+    EXPECT_EQ(mcts.m_root->node_visits, visits + 400);
+    EXPECT_EQ(board.m_moveRecord.size(), 3);
+}
+
+// 置换表检查：按预算分配，同键覆盖，优先替换旧回合与命中较少的槽位
+TEST(MCTSTest, TranspositionTable) {
+    TranspositionTable table(4 * sizeof(TranspositionTable::Bucket) + 1);
+    ASSERT_EQ(table.capacity(), 8);
+    ASSERT_LE(table.memory(), 4 * sizeof(TranspositionTable::Bucket) + 1);
+    auto result = [](float value) {
+        return Policy::EvalResult{ value, Eigen::VectorXf::Constant(BOARD_SIZE, value) };
+    };
+    EXPECT_FALSE(table.load(1));
+    table.store(1, result(0.1f));
+    table.store(1, result(0.2f));
+    ASSERT_TRUE(table.load(1));
+    EXPECT_EQ(std::get<0>(*table.load(1)), 0.2f);
+    EXPECT_EQ(std::get<1>(*table.load(1))[BOARD_SIZE - 1], 0.2f);
+    table.store(5, result(0.5f)); // 与键1同桶，占据第二个槽位
+    table.store(9, result(0.9f)); // 替换命中较少的键5
+    EXPECT_TRUE(table.load(1));
+    EXPECT_FALSE(table.load(5));
+    table.newSearch();
+    table.store(13, result(0.3f)); // 旧回合写入的槽位优先被替换，即使其命中较多
+    EXPECT_TRUE(table.load(13));
+    EXPECT_NE(bool(table.load(1)), bool(table.load(9)));
+    table.store(2, Policy::EvalResult{ 0.0f, Eigen::VectorXf::Zero(3) }); // 概率向量不完整时不缓存
+    EXPECT_FALSE(table.load(2));
+    table.clear();
+    EXPECT_FALSE(table.load(13));
+
+    // 共享统计量：首次累计以结点自身的统计量为初值，此后逐次累加；缓存评估结果不影响已有的统计量
+    EXPECT_FLOAT_EQ(table.accumulate(7, 1.0f, 3, 0.5f), 0.5f);
+    EXPECT_FALSE(table.load(7));
+    EXPECT_FLOAT_EQ(table.accumulate(7, -1.0f, 1, -1.0f), 0.125f);
+    table.store(7, result(0.7f));
+    EXPECT_TRUE(table.load(7));
+    EXPECT_FLOAT_EQ(table.accumulate(7, 1.0f, 1, 1.0f), 0.3f);
+    ASSERT_TRUE(table.shared(7));
+    EXPECT_EQ(table.shared(7)->first, 5);
+    EXPECT_FALSE(table.shared(3));
+}
+
+// 启用置换表后，经不同着法顺序到达的局面不再重复调用simulate。两种配置均经由MCTS::evaluate计数。
+TEST(MCTSTest, TranspositionSharing) {
+    size_t calls[2];
+    for (size_t table_size : { size_t(0), size_t(1) << 20 }) {
+        Board board;
+        MCTS mcts(size_t(500), -1, Player::White, std::make_shared<TraditionalPolicy>(), 1, MCTS::Parallelism::Tree, 1, table_size);
+        size_t& count = calls[table_size != 0] = 0;
+        for (int i = 0; i < 2; ++i) {
+            board.applyMove(mcts.getAction(board));
+            count += mcts.m_stats.evaluations;
+        }
+        if (mcts.m_table) {
+            EXPECT_GT(mcts.m_table->m_hits, 0);
+            EXPECT_EQ(mcts.m_table->m_probes - mcts.m_table->m_hits, count);
+        }
+    }
+    EXPECT_LT(calls[1], calls[0]);
+}
+
+// 共享统计量：同一局面的各个结点的访问次数之和即为表中累计的访问次数；随机Rollout的评估不被缓存
+TEST(MCTSTest, TranspositionStats) {
+    Board board;
+    MCTS mcts(size_t(1000), -1, Player::White, std::make_shared<TraditionalPolicy>(), 1, MCTS::Parallelism::Tree, 1, size_t(128) << 20); // 表足够大，不发生替换
+    mcts.c_seed = 2018;
+    mcts.evalState(board);
+    std::map<std::uint64_t, std::vector<const Node*>> positions;
+    std::function<void(const Node*, std::uint64_t)> collect = [&](const Node* node, std::uint64_t key) {
+        for (auto&& child : node->children) {
+            if (child) {
+                auto child_key = key ^ Board::ZobristKey(child->player, child->position) ^ Board::ZobristKey(Player::None);
+                positions[child_key].push_back(child.get());
+                collect(child.get(), child_key);
+            }
+        }
+    };
+    collect(mcts.m_root.get(), board.m_hash);
+    size_t transpositions = 0;
+    for (auto&& [key, nodes] : positions) {
+        size_t visits = 0;
+        for (auto node : nodes) {
+            visits += node->node_visits;
+        }
+        if (visits == 0) {
+            continue;
+        }
+        auto shared = mcts.m_table->shared(key);
+        ASSERT_TRUE(shared);
+        EXPECT_EQ(shared->first, visits);
+        if (nodes.size() > 1 && nodes[0]->node_visits && nodes[1]->node_visits) {
+            transpositions += 1;
+        }
+    }
+    EXPECT_GT(transpositions, 0);
+
+    MCTS random(size_t(300), -1, Player::White, std::make_shared<RandomPolicy>(C_PUCT, 1), 1, MCTS::Parallelism::Tree, 1, size_t(1) << 20);
+    random.evalState(board);
+    EXPECT_EQ(random.m_table->m_probes, 0);
+    EXPECT_EQ(random.m_stats.evaluations, 300);
+}
+
+// 时间管理器检查：整局预算的分摊，接近时延长思考，领先无法被追上时提前终止
+TEST(MCTSTest, TimeManager) {
+    using namespace std::chrono_literals;
+    auto root = std::make_unique<Node>();
+    for (int i = 0; i < 2; ++i) {
+        root->children.push_back(std::make_unique<Node>(root.get(), i, Player::Black));
+    }
+    auto set_visits = [&](size_t first, size_t second) {
+        root->children[0]->node_visits = first;
+        root->children[1]->node_visits = second;
+        root->node_visits = first + second;
+    };
+    TimeManager timer;
+    timer.c_checkInterval = 1;
+
+    timer.setBudget(60000ms);
+    timer.start(5000ms, 0, root.get());
+    EXPECT_EQ(timer.m_limit, 5000ms);
+    EXPECT_EQ(timer.m_target, 60000ms / ((BOARD_SIZE / 4) / 2));
+    timer.finish();
+    EXPECT_EQ(timer.m_remaining, 60000ms - timer.m_elapsed);
+
+    // 目标用时100ms，至多延长至200ms
+    timer.setBudget(1000ms);
+    set_visits(100, 90);
+    timer.start(1000ms, BOARD_SIZE, root.get());
+    ASSERT_EQ(timer.m_target, 100ms);
+    EXPECT_FALSE(timer.shouldStop(root.get()));
+    std::this_thread::sleep_for(120ms);
+    EXPECT_FALSE(timer.shouldStop(root.get()));
+    set_visits(100, 10);
+    EXPECT_TRUE(timer.shouldStop(root.get()));
+    set_visits(100, 90);
+    EXPECT_TRUE(timer.shouldStop(root.get())); // 一旦停止便不再恢复
+
+    // 按约0.5次/ms的速度，剩余时间内无法弥补10000次的差距
+    timer.setBudget(0ms);
+    set_visits(100, 90);
+    timer.start(10000ms, 0, root.get());
+    EXPECT_FALSE(timer.shouldStop(root.get()));
+    std::this_thread::sleep_for(20ms);
+    set_visits(110, 90);
+    EXPECT_FALSE(timer.shouldStop(root.get()));
+    set_visits(10100, 100);
+    root->node_visits = 200;
+    EXPECT_TRUE(timer.shouldStop(root.get()));
+    timer.finish();
+    EXPECT_LT(timer.m_elapsed, 1000ms);
+
+    // 用时上限不受检查间隔的限制：超过上限后的下一次调用即停止
+    timer.c_checkInterval = 1000;
+    set_visits(100, 90);
+    timer.start(30ms, 0, root.get());
+    EXPECT_FALSE(timer.shouldStop(root.get()));
+    EXPECT_FALSE(timer.shouldStop(root.get()));
+    std::this_thread::sleep_for(40ms);
+    EXPECT_TRUE(timer.shouldStop(root.get()));
+
+    // 根并行的汇报：两棵树各自领先的着法不同，汇总后前两名接近，到达目标用时仍延长思考
+    auto other = std::make_unique<Node>();
+    for (int i = 0; i < 2; ++i) {
+        other->children.push_back(std::make_unique<Node>(other.get(), i, Player::Black));
+    }
+    other->children[0]->node_visits = 10, other->children[1]->node_visits = 100, other->node_visits = 110;
+    TimeManager shared;
+    shared.c_checkInterval = 1;
+    shared.enableReports();
+    shared.setBudget(1000ms);
+    set_visits(100, 10);
+    shared.start(1000ms, BOARD_SIZE, root.get());
+    ASSERT_EQ(shared.m_target, 100ms);
+    TimeManager::Report mine, theirs;
+    shared.beginReport(root.get(), mine);
+    shared.beginReport(other.get(), theirs);
+    shared.report(root.get(), mine);
+    shared.report(other.get(), theirs);
+    EXPECT_FALSE(shared.shouldStop(nullptr));
+    std::this_thread::sleep_for(120ms);
+    EXPECT_FALSE(shared.shouldStop(nullptr)); // 单看任一棵树都已领先，汇总后110比110
+    set_visits(300, 10);
+    shared.report(root.get(), mine);
+    EXPECT_TRUE(shared.shouldStop(nullptr));
+}
+
+// 根并行按时间控制：由汇总树统一判断，前两名接近时各棵树一并延长思考，而不在目标用时处各自停止
+TEST(MCTSTest, EnsembleTimeManager) {
+    using namespace std::chrono_literals;
+    for (double close_ratio : { 0.0, 2.0 }) { // 0.0时总视为接近，2.0时从不视为接近
+        Board board;
+        MCTS mcts(300ms, -1, Player::White, std::make_shared<RandomPolicy>(C_PUCT, 1), 3, MCTS::Parallelism::Root);
+        ASSERT_EQ(mcts.m_ensemble.size(), 3);
+        mcts.m_timer.setBudget(2800ms);
+        mcts.m_timer.c_closeRatio = close_ratio;
+        mcts.m_timer.c_extension = 3.0;
+        mcts.getAction(board);
+        ASSERT_EQ(mcts.m_timer.m_target, 100ms); // 空棋盘预计剩余28手
+        if (close_ratio == 0.0) {
+            EXPECT_GE(mcts.m_timer.m_elapsed, 140ms); // 领先者至多领先全部迭代次数，延长至150ms前不会提前终止
+        } else {
+            EXPECT_LT(mcts.m_timer.m_elapsed, 250ms);
+        }
+        EXPECT_LE(mcts.m_timer.m_elapsed, 300ms + 100ms);
+    }
+}
+
+// 后台思考检查：停止后棋盘不变、结点计数正确，换根后保留已搜索的子树
+TEST(MCTSTest, Ponder) {
+    Board board;
+    auto policy = std::make_shared<RandomPolicy>(C_PUCT, 1);
+    MCTS mcts(size_t(200), -1, Player::White, policy);
+    board.applyMove(mcts.getAction(board));
+    const size_t visits = mcts.m_root->node_visits;
+
+    std::atomic<bool> stop = false;
+    size_t iterations = 0;
+    std::thread ponder([&]() { iterations = mcts.ponder(board, stop); });
+    std::this_thread::sleep_for(std::chrono::milliseconds(50));
+    stop = true;
+    ponder.join();
+
+    EXPECT_GT(iterations, 0);
+    EXPECT_EQ(mcts.m_root->node_visits, visits + iterations);
+    EXPECT_EQ(mcts.m_size, CountTree(mcts.m_root.get()));
+    EXPECT_EQ(board.m_moveRecord.size(), 1);
+    auto reply = std::max_element(mcts.m_root->children.begin(), mcts.m_root->children.end(), [](auto&& lhs, auto&& rhs) {
+        return (lhs ? size_t(lhs->node_visits) : 0) < (rhs ? size_t(rhs->node_visits) : 0);
+    });
+    ASSERT_NE(reply, mcts.m_root->children.end());
+    ASSERT_TRUE(*reply);
+    const size_t reply_visits = (*reply)->node_visits;
+    board.applyMove((*reply)->position);
+    mcts.syncWithBoard(board);
+    EXPECT_EQ(mcts.m_root->node_visits, reply_visits);
+    EXPECT_EQ(mcts.m_size, CountTree(mcts.m_root.get()));
+}
+
+// 后台思考的资源限制：未设置结点数预算时达到c_ponderBudget即自行结束；树并行与根并行时使用配置的线程数
+TEST(MCTSTest, PonderLimits) {
+    using namespace std::chrono_literals;
+    auto ponder_for = [](MCTS& mcts, Board& board, std::chrono::milliseconds duration) {
+        std::atomic<bool> stop = false;
+        auto result = std::async(std::launch::async, [&]() { return mcts.ponder(board, stop); });
+        auto status = result.wait_for(duration);
+        stop = true;
+        return std::make_pair(result.get(), status);
+    };
+    Board board;
+    board.applyMove(Position(7, 7));
+    {
+        MCTS mcts(size_t(100), -1, Player::White, std::make_shared<RandomPolicy>(C_PUCT, 1));
+        mcts.c_ponderBudget = 2000;
+        auto [iterations, status] = ponder_for(mcts, board, 10s);
+        EXPECT_EQ(status, std::future_status::ready); // 未等到stop便已结束
+        EXPECT_GE(mcts.m_size, mcts.c_ponderBudget);
+        EXPECT_LE(mcts.m_size, mcts.c_ponderBudget + BOARD_SIZE); // 至多超出一次扩展
+        EXPECT_EQ(mcts.m_size, CountTree(mcts.m_root.get()));
+        EXPECT_EQ(mcts.m_root->node_visits, iterations);
+    }
+    {
+        MCTS mcts(size_t(100), -1, Player::White, std::make_shared<RandomPolicy>(C_PUCT, 1), 4);
+        auto [iterations, status] = ponder_for(mcts, board, 100ms);
+        EXPECT_GT(iterations, 0);
+        EXPECT_EQ(mcts.m_root->node_visits, iterations); // 虚拟损失已被撤销
+        EXPECT_EQ(mcts.m_size, CountTree(mcts.m_root.get()));
+    }
+    {
+        MCTS mcts(size_t(100), -1, Player::White, std::make_shared<RandomPolicy>(C_PUCT, 1), 3, MCTS::Parallelism::Root);
+        ASSERT_EQ(mcts.m_ensemble.size(), 3);
+        auto [iterations, status] = ponder_for(mcts, board, 100ms);
+        size_t visits = 0, size = CountTree(mcts.m_root.get());
+        for (auto& tree : mcts.m_ensemble) {
+            EXPECT_GT(tree->m_root->node_visits, 0); // 每棵树都参与了后台思考
+            EXPECT_EQ(tree->m_root->position, board.m_moveRecord.back());
+            visits += tree->m_root->node_visits;
+            size += tree->m_size;
+        }
+        EXPECT_EQ(visits, iterations);
+        EXPECT_EQ(mcts.m_size, size);
+    }
+}
+
+// 结点预算检查：搜索中结点数至多超出一次扩展，剪枝后计数正确且根结点的子结点保持不变
+TEST(MCTSTest, NodeBudget) {
+    Board board;
+    auto policy = std::make_shared<RandomPolicy>(C_PUCT, 1);
+    MCTS mcts(size_t(3000), -1, Player::White, policy, 1, MCTS::Parallelism::Tree, 1, 0, 2000);
+    for (int i = 0; i < 3; ++i) {
+        board.applyMove(mcts.getAction(board));
+        EXPECT_LE(mcts.m_size, 2000);
+        EXPECT_EQ(mcts.m_size, CountTree(mcts.m_root.get()));
+    }
+    mcts.syncWithBoard(board);
+    const size_t visits = mcts.m_root->node_visits;
+    mcts.evalState(board);
+    EXPECT_EQ(mcts.m_root->node_visits, visits + 3000);
+
+    MCTS unbounded(size_t(3000), -1, Player::White, policy);
+    unbounded.evalState(board);
+    const size_t size = unbounded.m_size, children = unbounded.m_root->children.size();
+    ASSERT_GT(size, 1000);
+    unbounded.c_nodeBudget = 1000;
+    unbounded.prune();
+    EXPECT_LE(unbounded.m_size, 750);
+    EXPECT_EQ(unbounded.m_size, CountTree(unbounded.m_root.get()));
+    EXPECT_EQ(unbounded.m_root->children.size(), children);
+}
+
+// 静态拼装的策略在单线程搜索时走StaticPlayout，树并行时经由不可替换的std::function，二者调用同一个Simulate
+TEST(MCTSTest, StaticPlayout) {
+    static_assert(std::is_const_v<decltype(Policy::simulate)>);
+    auto check = [](std::shared_ptr<Policy> policy) {
+        ASSERT_NE(policy->playoutKernel, nullptr);
+        Board board;
+        MCTS mcts(size_t(300), -1, Player::White, policy);
+        for (int i = 0; i < 2; ++i) {
+            board.applyMove(mcts.getAction(board));
+            EXPECT_EQ(mcts.m_size, CountTree(mcts.m_root.get()));
+        }
+        mcts.syncWithBoard(board);
+        const size_t visits = mcts.m_root->node_visits;
+        mcts.evalState(board);
+        EXPECT_EQ(mcts.m_root->node_visits, visits + 300);
+    };
+    check(std::make_shared<RandomPolicy>(C_PUCT, 1));
+    check(std::make_shared<PoolRAVEPolicy>());
+    check(std::make_shared<TraditionalPolicy>());
+    EXPECT_EQ(Policy().playoutKernel, nullptr);
+
+    for (size_t threads : { 1, 4 }) {
+        auto policy = std::make_shared<CountingPolicy>();
+        Board board;
+        MCTS mcts(size_t(300), -1, Player::White, policy, threads);
+        mcts.evalState(board);
+        EXPECT_EQ(policy->m_calls, 300); // 空棋盘附近不会终局，每轮迭代都评估一次叶结点
+        EXPECT_EQ(mcts.m_stats.evaluations, 300);
+    }
+}
+
+// 逐个比较两棵树的结点属性与镜像
+static void ExpectSameTree(const Node* lhs, const Node* rhs) {
+    ASSERT_EQ(lhs->position, rhs->position);
+    ASSERT_EQ(lhs->player, rhs->player);
+    EXPECT_EQ(size_t(lhs->node_visits), size_t(rhs->node_visits));
+    EXPECT_FLOAT_EQ(lhs->state_value, rhs->state_value);
+    ASSERT_EQ(lhs->children.size(), rhs->children.size());
+    const auto n = lhs->children.size();
+    for (size_t i = 0; i < n; ++i) {
+        EXPECT_EQ(lhs->childPosition(i), rhs->childPosition(i));
+        EXPECT_FLOAT_EQ(lhs->childPriors()[i], rhs->childPriors()[i]);
+        EXPECT_FLOAT_EQ(lhs->childVisits()[i], rhs->childVisits()[i]);
+        ASSERT_EQ(lhs->children[i] == nullptr, rhs->children[i] == nullptr);
+        if (lhs->children[i]) {
+            EXPECT_EQ(rhs->children[i]->parent, rhs);
+            EXPECT_EQ(rhs->children[i]->index, i);
+            ExpectSameTree(lhs->children[i].get(), rhs->children[i].get());
+        }
+    }
+}
+
+// 树的持久化：读回的树与原树一致，可推进至后续局面；着法记录不符的文件不被读入
+TEST(MCTSTest, TreePersistence) {
+    const std::string path = "mcts_tree_test.bin";
+    Board board;
+    board.applyMove(112);
+    MCTS mcts(size_t(500), 112, Player::Black, std::make_shared<RandomPolicy>(C_PUCT, 1));
+    mcts.evalState(board);
+    ASSERT_TRUE(mcts.save(path, board));
+
+    MCTS loaded(size_t(500), -1, Player::White, std::make_shared<RandomPolicy>(C_PUCT, 1));
+    ASSERT_TRUE(loaded.load(path, board));
+    EXPECT_EQ(loaded.m_size, mcts.m_size);
+    EXPECT_EQ(loaded.m_size, CountTree(loaded.m_root.get()));
+    ExpectSameTree(mcts.m_root.get(), loaded.m_root.get());
+
+    // 下一回合的进程：棋盘多了双方各一手，读回后推进至最新局面
+    Board next = board;
+    next.applyMove(mcts.stepForward()->position);
+    next.applyMove(next.getRandomMove());
+    MCTS resumed(size_t(500), -1, Player::White, std::make_shared<RandomPolicy>(C_PUCT, 1));
+    ASSERT_TRUE(resumed.load(path, next));
+    mcts.syncWithBoard(next);
+    EXPECT_EQ(resumed.m_root->position, next.m_moveRecord.back());
+    EXPECT_EQ(resumed.m_size, CountTree(resumed.m_root.get()));
+    ExpectSameTree(mcts.m_root.get(), resumed.m_root.get());
+    const size_t visits = resumed.m_root->node_visits;
+    resumed.evalState(next);
+    EXPECT_EQ(resumed.m_root->node_visits, visits + 500);
+
+    Board other;
+    other.applyMove(113);
+    MCTS rejected(size_t(500), -1, Player::White, std::make_shared<RandomPolicy>(C_PUCT, 1));
+    EXPECT_FALSE(rejected.load(path, other));
+    EXPECT_FALSE(rejected.load(path + ".missing", board));
+    EXPECT_EQ(rejected.m_size, 1);
+    EXPECT_EQ(rejected.m_root->position, -1);
+    std::remove(path.c_str());
+}
+
+// 搜索统计量：计数与树的变化一致，单线程时各阶段均有抽样用时，树并行时汇总各线程的计数
+TEST(MCTSTest, SearchStats) {
+    Board board;
+    MCTS mcts(size_t(400), -1, Player::White, std::make_shared<RandomPolicy>(C_PUCT, 1));
+    board.applyMove(mcts.getAction(board));
+    board.applyMove(board.getRandomMove());
+    mcts.syncWithBoard(board);
+    const size_t size = mcts.m_size, visits = mcts.m_root->node_visits;
+    mcts.evalState(board);
+
+    auto& stats = mcts.m_stats;
+    EXPECT_EQ(stats.playouts, 400);
+    EXPECT_EQ(stats.reused_nodes, size);
+    EXPECT_EQ(stats.reused_visits, visits);
+    EXPECT_EQ(stats.root_visits, visits + 400);
+    EXPECT_EQ(stats.nodes_created, mcts.m_size - size);
+    EXPECT_GE(stats.averageDepth(), 1.0);
+    EXPECT_GE(stats.max_depth, stats.averageDepth());
+    EXPECT_EQ(stats.sampled, (400 + C_SAMPLE_INTERVAL - 1) / C_SAMPLE_INTERVAL);
+    for (auto phase : { SearchStats::Select, SearchStats::Simulate, SearchStats::BackPropogate }) {
+        EXPECT_GT(stats.phaseTime(phase).count(), 0);
+    }
+
+    MCTS concurrent(size_t(400), -1, Player::White, std::make_shared<RandomPolicy>(C_PUCT, 1), 4);
+    concurrent.evalState(board);
+    EXPECT_EQ(concurrent.m_stats.playouts, concurrent.m_stats.root_visits);
+    EXPECT_EQ(concurrent.m_stats.sampled, 0);
+}
+
+// 确定性模式：相同种子、相同局面的两次搜索得到完全相同的树，根并行时亦然；换用其他种子则结果不同
+TEST(MCTSTest, DeterministicMode) {
+    auto search = [](std::uint64_t seed, size_t threads) {
+        Board board;
+        auto mcts = std::make_unique<MCTS>(size_t(300), -1, Player::White, std::make_shared<RandomPolicy>(C_PUCT, 1), threads, MCTS::Parallelism::Root);
+        mcts->c_seed = seed;
+        for (int i = 0; i < 3; ++i) {
+            board.applyMove(mcts->getAction(board));
+        }
+        mcts->evalState(board);
+        return mcts;
+    };
+    for (size_t threads : { 1, 2 }) {
+        auto lhs = search(2018, threads), rhs = search(2018, threads), other = search(2019, threads);
+        EXPECT_EQ(lhs->m_size, rhs->m_size);
+        ExpectSameTree(lhs->m_root.get(), rhs->m_root.get());
+        for (size_t i = 0; i < lhs->m_ensemble.size(); ++i) {
+            ExpectSameTree(lhs->m_ensemble[i]->m_root.get(), rhs->m_ensemble[i]->m_root.get());
+        }
+        bool differs = lhs->m_root->children.size() != other->m_root->children.size();
+        for (size_t i = 0; !differs && i < lhs->m_root->children.size(); ++i) {
+            differs = lhs->m_root->childVisits()[i] != other->m_root->childVisits()[i] || lhs->m_root->childPosition(i) != other->m_root->childPosition(i);
+        }
+        EXPECT_TRUE(differs);
+    }
+}
+
+// MCTS-Solver：必胜着法被证明后，搜索提前结束并选出该着法；证明按极小极大规则向上传播
+TEST(MCTSTest, ProvenNodes) {
+    using Algorithms::Default;
+    Board board;
+    for (auto move : { Position(7, 3), Position(0, 0), Position(7, 4), Position(0, 2), Position(7, 5), Position(0, 4), Position(7, 6), Position(0, 6) }) {
+        board.applyMove(move);
+    }
+    for (auto policy : { std::shared_ptr<Policy>(new RandomPolicy(C_PUCT, 1)), std::shared_ptr<Policy>(new PoolRAVEPolicy) }) {
+        MCTS mcts(size_t(5000), -1, Player::White, policy);
+        auto move = mcts.getAction(board);
+        EXPECT_TRUE(move == Position(7, 2) || move == Position(7, 7));
+        EXPECT_LT(mcts.m_stats.playouts, 5000);
+        EXPECT_EQ(mcts.m_root->proof, Node::Proof::Win);
+        EXPECT_FLOAT_EQ(mcts.m_root->state_value, 1.0f);
+        EXPECT_TRUE(mcts.solved());
+    }
+
+    // 树并行同样在已证明的结点处停止向下搜索：复用已证明的树时，子树的访问次数不再增加
+    {
+        MCTS mcts(size_t(5000), -1, Player::White, std::make_shared<RandomPolicy>(C_PUCT, 1));
+        mcts.evalState(board); // 不换根，以便再次搜索同一棵树
+        ASSERT_TRUE(mcts.solved());
+        std::vector<size_t> visits;
+        for (auto&& child : mcts.m_root->children) {
+            visits.push_back(child ? static_cast<size_t>(child->node_visits) : 0);
+        }
+        auto root_visits = static_cast<size_t>(mcts.m_root->node_visits);
+        auto proof = mcts.m_root->proof;
+        mcts.c_threads = 4;
+        mcts.m_iterations = 200;
+        mcts.evalState(board);
+        EXPECT_EQ(mcts.m_root->node_visits, root_visits + 200);
+        EXPECT_EQ(mcts.m_root->proof, proof);
+        for (size_t i = 0; i < visits.size(); ++i) {
+            auto child = mcts.m_root->children[i].get();
+            EXPECT_EQ(child ? static_cast<size_t>(child->node_visits) : 0, visits[i]);
+        }
+    }
+
+    // 根结点局面仅剩两个空位：两个子结点各自的唯一应手均获胜后，根结点才被证明为必胜
+    Node root(nullptr, Position(-1), Player::White);
+    for (int i = 0; i < 2; ++i) {
+        auto& child = root.children.emplace_back(new Node(&root, i, Player::Black));
+        child->children.emplace_back(new Node(child.get(), 1 - i, Player::White));
+        child->buildStats();
+    }
+    root.buildStats();
+    Default::Prove(root.children[0]->children[0].get(), Player::White, BOARD_SIZE - 2);
+    EXPECT_EQ(root.children[0]->proof, Node::Proof::Loss);
+    EXPECT_EQ(root.childValues()[0], -C_PROVEN_VALUE);
+    EXPECT_EQ(root.proof, Node::Proof::None);
+    Default::Prove(root.children[1]->children[0].get(), Player::White, BOARD_SIZE - 2);
+    EXPECT_EQ(root.proof, Node::Proof::Win);
+
+    // 有一个子结点未被证明时，其余子结点均为和棋也不能证明根结点
+    Node draw(nullptr, Position(-1), Player::White);
+    for (int i = 0; i < 2; ++i) {
+        draw.children.emplace_back(new Node(&draw, i, Player::Black));
+    }
+    draw.buildStats();
+    Default::Prove(draw.children[0].get(), Player::None, BOARD_SIZE - 2);
+    EXPECT_EQ(draw.children[0]->proof, Node::Proof::Draw);
+    EXPECT_EQ(draw.proof, Node::Proof::None);
+    Default::Prove(draw.children[1].get(), Player::None, BOARD_SIZE - 2);
+    EXPECT_EQ(draw.proof, Node::Proof::Draw);
+}
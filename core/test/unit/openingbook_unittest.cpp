@@ -0,0 +1,85 @@
+#include "pch.h"
+#include "lib/include/OpeningBook.h"
+#include "lib/include/MCTS.h"
+#include "lib/include/policies/Random.h"
+#include <cstdio>
+
+using namespace Gomoku;
+using namespace Gomoku::Policies;
+
+TEST(OpeningBookTest, SymmetryInverse) {
+    for (int s = 0; s < OpeningBook::Symmetries; ++s) {
+        for (int i = 0; i < BOARD_SIZE; ++i) {
+            ASSERT_EQ(OpeningBook::Inverse(OpeningBook::Transform(i, s), s), i);
+        }
+    }
+}
+
+// 对称的局面得到相同的规范键值，且键值不依赖着法顺序
+TEST(OpeningBookTest, CanonicalKey) {
+    Board board, mirrored, reordered;
+    for (Position move : { Position(7, 7), Position(8, 6), Position(6, 6) }) {
+        board.applyMove(move);
+        mirrored.applyMove(OpeningBook::Transform(move, 1));
+    }
+    for (Position move : { Position(6, 6), Position(8, 6), Position(7, 7) }) {
+        reordered.applyMove(move);
+    }
+    EXPECT_EQ(OpeningBook::CanonicalKey(board).first, OpeningBook::CanonicalKey(mirrored).first);
+    EXPECT_EQ(OpeningBook::CanonicalKey(board).first, OpeningBook::CanonicalKey(reordered).first);
+    mirrored.applyMove(0);
+    EXPECT_NE(OpeningBook::CanonicalKey(board).first, OpeningBook::CanonicalKey(mirrored).first);
+}
+
+// 写出后映射读回：按权重排序，对称局面查得变换后的着法，收录搜索树
+TEST(OpeningBookTest, BuildAndProbe) {
+    const std::string path = "opening_book_test.bin";
+    Board board;
+    board.applyMove(Position(7, 7));
+    board.applyMove(Position(8, 6));
+
+    OpeningBook::Builder builder;
+    builder.add(board, Position(6, 8), 10, 0.5f);
+    builder.add(board, Position(6, 8), 30, 0.1f);
+    builder.add(board, Position(9, 5), 20, -0.2f);
+
+    Board root;
+    MCTS mcts(size_t(300), -1, Player::White, std::make_shared<RandomPolicy>(C_PUCT, 1));
+    mcts.evalState(root);
+    builder.addTree(mcts.m_root.get(), root, 10);
+    ASSERT_TRUE(builder.write(path));
+
+    OpeningBook book(path);
+    ASSERT_TRUE(book.isOpen());
+    EXPECT_EQ(book.size(), builder.size());
+
+    auto moves = book.probe(board);
+    ASSERT_EQ(moves.size(), 2);
+    EXPECT_EQ(moves[0].move, Position(6, 8));
+    EXPECT_EQ(moves[0].weight, 40);
+    EXPECT_FLOAT_EQ(moves[0].value, 0.2f);
+    EXPECT_EQ(moves[1].move, Position(9, 5));
+
+    Board mirrored;
+    for (auto move : board.m_moveRecord) {
+        mirrored.applyMove(OpeningBook::Transform(move, 2));
+    }
+    moves = book.probe(mirrored);
+    ASSERT_EQ(moves.size(), 2);
+    EXPECT_EQ(moves[0].move, OpeningBook::Transform(Position(6, 8), 2));
+
+    auto best = std::max_element(mcts.m_root->children.begin(), mcts.m_root->children.end(), [](auto&& lhs, auto&& rhs) {
+        return (lhs ? size_t(lhs->node_visits) : 0) < (rhs ? size_t(rhs->node_visits) : 0);
+    });
+    moves = book.probe(root);
+    ASSERT_FALSE(moves.empty());
+    EXPECT_EQ(moves[0].weight, (*best)->node_visits);
+
+    board.applyMove(0);
+    EXPECT_TRUE(book.probe(board).empty());
+
+    book.close();
+    std::remove(path.c_str());
+    EXPECT_FALSE(book.open(path));
+    EXPECT_TRUE(book.probe(root).empty());
+}
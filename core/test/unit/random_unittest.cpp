@@ -0,0 +1,46 @@
+#include "pch.h"
+#include "lib/include/Game.h"
+#include <thread>
+#include <vector>
+
+using namespace Gomoku;
+
+TEST(RandomEngineTest, SeedReproducible) {
+    RandomEngine engine1(42), engine2(42), engine3(43);
+    bool differs = false;
+    for (int i = 0; i < 100; ++i) {
+        auto value = engine1();
+        ASSERT_EQ(value, engine2());
+        differs |= value != engine3();
+    }
+    ASSERT_TRUE(differs);
+}
+
+TEST(RandomEngineTest, BoundedRange) {
+    RandomEngine engine(7);
+    for (std::uint32_t bound : { 1u, 2u, 3u, 225u, 400u, 1u << 31 }) {
+        for (int i = 0; i < 1000; ++i) {
+            ASSERT_LT(engine.bounded(bound), bound);
+        }
+    }
+}
+
+// 只播种一次：其他线程的播种与取数既不改变当前线程引擎的序列，也不取用当前线程的序列
+TEST(RandomEngineTest, ThreadLocalSeed) {
+    RandomEngine::Seed(2018);
+    RandomEngine expected(2018), expected_other(0);
+    ASSERT_EQ(RandomEngine::Local()(), expected());
+    std::vector<RandomEngine::result_type> other;
+    std::thread([&] {
+        RandomEngine::Seed(0);
+        for (int i = 0; i < 100; ++i) {
+            other.push_back(RandomEngine::Local()());
+        }
+    }).join();
+    for (auto value : other) {
+        ASSERT_EQ(value, expected_other());
+    }
+    for (int i = 0; i < 100; ++i) {
+        ASSERT_EQ(RandomEngine::Local()(), expected());
+    }
+}
@@ -108,6 +108,13 @@ class PolicyValueNetwork:
         # format to (float, np.array((255,1),dtype=float)) structure
         return vp[0][0][0], vp[1][0]
 
+    def eval_states(self, states):
+        """
+        Evaluate a batch of board states in one forward pass.
+        """
+        vp = self.model.predict_on_batch(np.stack([state.encoded_states() for state in states]))
+        return [(v[0], p) for v, p in zip(vp[0], vp[1])]
+
     def train_step(self, optimizer):
         """
         One Network Tranning step.
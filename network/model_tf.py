@@ -145,6 +145,17 @@ class PolicyValueNetwork:
         )
         return value[0], probs[0]
 
+    def eval_states(self, states):
+        """
+        Evaluate a batch of board states in one session run.
+        """
+        self._lazy_initialize()
+        values, probs = self.session.run(
+            [self.value_output, self.policy_output],
+            feed_dict={self.inputs: np.stack([state.encoded_states() for state in states])}
+        )
+        return [(v, p) for v, p in zip(values, probs)]
+
     def save_model(self, model_name):
         self.saver.save(self.session, self._parse_path(model_name))
 